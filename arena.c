@@ -0,0 +1,118 @@
+/*  arena.c  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdalign.h>
+#include <string.h>
+
+#include "arena.h"
+
+#define ARENABYTES 65536
+
+// A block of objects, chained so the arena can be released at once
+struct _block
+{
+    struct _block  *next;
+    alignas(max_align_t) unsigned char data[];
+};
+
+// Setting up an arena for objects of a given size
+void
+arenaInit(
+    struct arena *a,
+    const char *name,
+    size_t size)
+{
+    memset(a, 0, sizeof(*a));
+
+    // Keeping every object aligned and big enough for the free list
+    if (size < sizeof(void *))
+    {
+        size = sizeof(void *);
+    }
+    size = (size + alignof(max_align_t) - 1) & ~(alignof(max_align_t) - 1);
+
+    a->name = name;
+    a->size = size;
+    a->perBlock = size < ARENABYTES ? ARENABYTES / size : 1;
+    a->used = a->perBlock;
+}
+
+// Handing out a zeroed object, NULL if a new block could not be made
+void           *
+arenaAlloc(
+    struct arena *a)
+{
+    void           *p;
+
+    // Reusing an object that was given back
+    if (a->freed)
+    {
+        p = a->freed;
+        memcpy(&a->freed, p, sizeof(a->freed));
+    }
+    else
+    {
+        if (a->used == a->perBlock)
+        {
+            struct _block  *b =
+                malloc(sizeof(*b) + a->perBlock * a->size);
+
+            if (!b)
+            {
+                return NULL;
+            }
+            b->next = a->blocks;
+            a->blocks = b;
+            a->used = 0;
+            a->totalBlocks++;
+        }
+        p = a->blocks->data + a->used++ * a->size;
+    }
+
+    a->totalObjects++;
+    memset(p, 0, a->size);
+
+    return p;
+}
+
+// Giving an object back to be handed out again
+void
+arenaFree(
+    struct arena *a,
+    void *p)
+{
+    if (!p)
+    {
+        return;
+    }
+
+    memcpy(p, &a->freed, sizeof(a->freed));
+    a->freed = p;
+}
+
+// Releasing every block the arena made
+void
+arenaRelease(
+    struct arena *a)
+{
+    while (a->blocks)
+    {
+        struct _block  *freeMe = a->blocks;
+
+        a->blocks = freeMe->next;
+        free(freeMe);
+    }
+    a->freed = NULL;
+    a->used = a->perBlock;
+}
+
+// Printing how many objects were handed out against blocks allocated
+void
+arenaPrint(
+    struct arena *a,
+    FILE * fp)
+{
+    fprintf(fp, "%-8s %10zu objects %6zu blocks %10zu mallocs saved\n",
+            a->name, a->totalObjects, a->totalBlocks,
+            a->totalObjects - a->totalBlocks);
+}
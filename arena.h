@@ -0,0 +1,46 @@
+/*  arena.h  */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// A pool of same sized objects carved out of large blocks
+struct arena
+{
+    const char     *name;
+    size_t          size;
+    size_t          perBlock;
+    size_t          used;
+    struct _block  *blocks;
+    void           *freed;
+    size_t          totalObjects;
+    size_t          totalBlocks;
+};
+
+// Setting up an arena for objects of a given size
+void            arenaInit(
+    struct arena *a,
+    const char *name,
+    size_t size);
+
+// Handing out a zeroed object, NULL if a new block could not be made
+void           *arenaAlloc(
+    struct arena *a);
+
+// Giving an object back to be handed out again
+void            arenaFree(
+    struct arena *a,
+    void *p);
+
+// Releasing every block the arena made
+void            arenaRelease(
+    struct arena *a);
+
+// Printing how many objects were handed out against blocks allocated
+void            arenaPrint(
+    struct arena *a,
+    FILE * fp);
+
+#endif
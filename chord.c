@@ -0,0 +1,290 @@
+/*  chord.c  */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "chord.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CHORDX86
+#include <immintrin.h>
+#endif
+
+#define TO_RAD (3.1415926536 / 180)
+
+// Marking the points from first on one at a time
+static void     _withinScalar(
+    struct chordBlock *b,
+    const double from[3],
+    double limit2,
+    size_t first);
+
+#ifdef CHORDX86
+#ifdef __SSE2__
+// Marking points two at a time, returns where it stopped
+static size_t   _withinSse2(
+    struct chordBlock *b,
+    const double from[3],
+    double limit2);
+#endif
+
+// Marking points four at a time, returns where it stopped
+static size_t   _withinAvx2(
+    struct chordBlock *b,
+    const double from[3],
+    double limit2) __attribute__ ((target("avx2")));
+
+// Testing the four points from i, returns a bit for each one in range
+static int      _quadAvx2(
+    const struct chordBlock *b,
+    size_t i,
+    const double from[3],
+    double limit2) __attribute__ ((target("avx2")));
+#endif
+
+/*
+ * Each point sits R + h from the center. Two points an angle t apart with
+ * chord c = 2 sin(t / 2) between their unit vectors are
+ * dh^2 + (R + h1)(R + h2) c^2 apart squared, while dist() and the altitude
+ * difference give dh^2 + (2R asin(c / 2))^2. Those differ by about
+ * (h1 + h2) / R of the horizontal part, plus c^2 / 12 for the arc, which is
+ * nothing at 15 meters. Altitudes are within 11265.4 meters, so the squared
+ * distances are at most 0.36% apart and the distances 0.18%, about 2.7 cm
+ * at 15 meters. chordError doubles that to cover the rest of the terms and
+ * rounding. Deciding pairs on these only takes multiplies and adds, so
+ * whole runs of points are tested at once.
+ */
+
+// Making room for size points, returns true if they couldn't be allocated
+bool
+chordReserve(
+    struct chordBlock *b,
+    size_t size)
+{
+    double         *x;
+    double         *y;
+    double         *z;
+    unsigned char  *marks;
+
+    if (size <= b->size)
+    {
+        return false;
+    }
+
+    // Growing each array, a failure leaves the old ones in place
+    if ((x = realloc(b->x, size * sizeof(*x))))
+    {
+        b->x = x;
+    }
+    if ((y = realloc(b->y, size * sizeof(*y))))
+    {
+        b->y = y;
+    }
+    if ((z = realloc(b->z, size * sizeof(*z))))
+    {
+        b->z = z;
+    }
+    if ((marks = realloc(b->marks, size * sizeof(*marks))))
+    {
+        b->marks = marks;
+    }
+
+    if (!x || !y || !z || !marks)
+    {
+        return true;
+    }
+    b->size = size;
+
+    return false;
+}
+
+// Freeing the arrays of a block
+void
+chordFree(
+    struct chordBlock *b)
+{
+    free(b->x);
+    free(b->y);
+    free(b->z);
+    free(b->marks);
+    b->x = b->y = b->z = NULL;
+    b->marks = NULL;
+    b->count = 0;
+    b->size = 0;
+}
+
+// Setting the Earth centered point in meters for a latitude and longitude in
+// degrees and an altitude in meters
+void
+chordPoint(
+    double latitude,
+    double longitude,
+    double altitude,
+    double point[3])
+{
+    double          lat = latitude * TO_RAD;
+    double          lon = longitude * TO_RAD;
+    double          r = CHORDRADIUS + altitude;
+
+    point[0] = r * cos(lat) * cos(lon);
+    point[1] = r * cos(lat) * sin(lon);
+    point[2] = r * sin(lat);
+}
+
+// Returning the squared distance between two points
+double
+chordDistance2(
+    const double a[3],
+    const double b[3])
+{
+    double          dx = a[0] - b[0];
+    double          dy = a[1] - b[1];
+    double          dz = a[2] - b[2];
+
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// Returning how far off, as a fraction of it, the squared distance between
+// points at two altitudes can be from the one dist() and the altitude
+// difference give
+double
+chordError(
+    double a,
+    double b)
+{
+    return 2 * (fabs(a) + fabs(b)) / CHORDRADIUS + 1e-9;
+}
+
+// Marking every point in the block that could be within limit meters of
+// from, returns how many were marked
+size_t
+chordWithin(
+    struct chordBlock *b,
+    const double from[3],
+    double limit)
+{
+    double          limit2 = (limit + CHORDSLACK) * (limit + CHORDSLACK);
+    size_t          first = 0;
+    size_t          marked = 0;
+
+#ifdef CHORDX86
+    if (__builtin_cpu_supports("avx2"))
+    {
+        first = _withinAvx2(b, from, limit2);
+    }
+#ifdef __SSE2__
+    else
+    {
+        first = _withinSse2(b, from, limit2);
+    }
+#endif
+#endif
+    _withinScalar(b, from, limit2, first);
+
+    for (size_t i = 0; i < b->count; i++)
+    {
+        marked += b->marks[i];
+    }
+
+    return marked;
+}
+
+// Marking the points from first on one at a time
+static void
+_withinScalar(
+    struct chordBlock *b,
+    const double from[3],
+    double limit2,
+    size_t first)
+{
+    for (size_t i = first; i < b->count; i++)
+    {
+        double          dx = b->x[i] - from[0];
+        double          dy = b->y[i] - from[1];
+        double          dz = b->z[i] - from[2];
+
+        b->marks[i] = dx * dx + dy * dy + dz * dz <= limit2;
+    }
+}
+
+#ifdef CHORDX86
+#ifdef __SSE2__
+// Marking points two at a time, returns where it stopped
+static size_t
+_withinSse2(
+    struct chordBlock *b,
+    const double from[3],
+    double limit2)
+{
+    __m128d         fx = _mm_set1_pd(from[0]);
+    __m128d         fy = _mm_set1_pd(from[1]);
+    __m128d         fz = _mm_set1_pd(from[2]);
+    __m128d         lim = _mm_set1_pd(limit2);
+    size_t          i = 0;
+
+    for (; i + 2 <= b->count; i += 2)
+    {
+        __m128d         dx = _mm_sub_pd(_mm_loadu_pd(&b->x[i]), fx);
+        __m128d         dy = _mm_sub_pd(_mm_loadu_pd(&b->y[i]), fy);
+        __m128d         dz = _mm_sub_pd(_mm_loadu_pd(&b->z[i]), fz);
+        __m128d         d2 =
+            _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)),
+                       _mm_mul_pd(dz, dz));
+        int             mask = _mm_movemask_pd(_mm_cmple_pd(d2, lim));
+
+        b->marks[i] = mask & 1;
+        b->marks[i + 1] = (mask >> 1) & 1;
+    }
+
+    return i;
+}
+#endif
+
+// Marking points four at a time, returns where it stopped
+static size_t
+_withinAvx2(
+    struct chordBlock *b,
+    const double from[3],
+    double limit2)
+{
+    size_t          i = 0;
+
+    for (; i + 4 <= b->count; i += 4)
+    {
+        int             mask = _quadAvx2(b, i, from, limit2);
+
+        for (int lane = 0; lane < 4; lane++)
+        {
+            b->marks[i + lane] = (mask >> lane) & 1;
+        }
+    }
+
+    // Unoptimized builds don't clear the upper halves on their own, and
+    // leaving them dirty slows down every SSE instruction that follows
+    _mm256_zeroupper();
+
+    return i;
+}
+
+// Testing the four points from i, returns a bit for each one in range
+static int
+_quadAvx2(
+    const struct chordBlock *b,
+    size_t i,
+    const double from[3],
+    double limit2)
+{
+    __m256d         d;
+    __m256d         sum;
+
+    d = _mm256_sub_pd(_mm256_loadu_pd(&b->x[i]), _mm256_set1_pd(from[0]));
+    sum = _mm256_mul_pd(d, d);
+    d = _mm256_sub_pd(_mm256_loadu_pd(&b->y[i]), _mm256_set1_pd(from[1]));
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(d, d));
+    d = _mm256_sub_pd(_mm256_loadu_pd(&b->z[i]), _mm256_set1_pd(from[2]));
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(d, d));
+
+    return _mm256_movemask_pd(_mm256_cmp_pd(sum, _mm256_set1_pd(limit2),
+                                            _CMP_LE_OQ));
+}
+#endif
@@ -0,0 +1,63 @@
+/*  chord.h  */
+
+#ifndef CHORD_H
+#define CHORD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// The radius dist() measures with, in meters
+#define CHORDRADIUS 6371000.0
+
+// Rounding between dist() and the chord is far below a millimeter
+#define CHORDSLACK 0.001
+
+// Earth centered points, one coordinate per array so a run of them can be
+// loaded at once
+struct chordBlock
+{
+    double         *x;
+    double         *y;
+    double         *z;
+    unsigned char  *marks;
+    size_t          count;
+    size_t          size;
+};
+
+// Making room for size points, returns true if they couldn't be allocated
+bool            chordReserve(
+    struct chordBlock *b,
+    size_t size);
+
+// Freeing the arrays of a block
+void            chordFree(
+    struct chordBlock *b);
+
+// Setting the Earth centered point in meters for a latitude and longitude in
+// degrees and an altitude in meters
+void            chordPoint(
+    double latitude,
+    double longitude,
+    double altitude,
+    double point[3]);
+
+// Returning the squared distance between two points
+double          chordDistance2(
+    const double a[3],
+    const double b[3]);
+
+// Returning how far off, as a fraction of it, the squared distance between
+// points at two altitudes can be from the one dist() and the altitude
+// difference give
+double          chordError(
+    double a,
+    double b);
+
+// Marking every point in the block that could be within limit meters of
+// from, returns how many were marked
+size_t          chordWithin(
+    struct chordBlock *b,
+    const double from[3],
+    double limit);
+
+#endif
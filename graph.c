@@ -3,87 +3,176 @@
 #include <stdbool.h>
 #include <string.h>
 #include <math.h>
+#include <stdint.h>
 
 #include "graph.h"
 #include "util.h"
+#include "arena.h"
+#include "zergDiag.h"
+#include "chord.h"
 
-#define INITWEIGHT 1000000
-#define HEAVYEDGE 1000
+#define ZERGIDS 65536
+
+// Edges only form within 15 meters, so the grid cells are that size
+#define EDGEDIST 15.0000
+#define CLOSEDIST 1.1430
+#define EARTHMETERS 6371000.0
+#define PI 3.1415926536
+#define TO_RAD (PI / 180)
+#define CELLANGLE (EDGEDIST / EARTHMETERS * 1.000001)
+#define INITCELLS 1024
 
 // Initializing Structs
 struct _graph
 {
     struct _node   *nodes;
+    struct _node   *tail;
     struct _stack  *badNodes;
     size_t          totalBad;
     size_t          totalNodes;
     size_t          totalEdges;
-} _graph;
+    size_t          totalInvalid;
+    size_t          totalPairs;
+    size_t          totalFiltered;
+    size_t          totalExact;
+    size_t          totalOrder;
+    struct _cell  **cells;
+    size_t          cellBuckets;
+    size_t          totalCells;
+    struct _node  **nearby;
+    size_t          nearbySize;
+    struct chordBlock block;
+    double          highest;
+    bool            deferEdges;
+    size_t          totalPlaced;
+    struct _node   *pending;
+    struct _node   *pendingTail;
+    bool            outOfMemory;
+    struct arena    nodeArena;
+    struct arena    edgeArena;
+    struct arena    stackArena;
+    struct arena    gpsArena;
+    struct arena    statusArena;
+    struct arena    cellArena;
+    struct _node   *index[ZERGIDS];
+};
 
 struct _data
 {
     union zergH     zHead;
     struct statusH *status;
     struct gpsH    *gps;
-} _data;
+};
 
 struct _node
 {
     size_t          edgeCount;
+    size_t          order;
+    size_t          id;
     struct _data    data;
-    bool            visited;
-    double          weight;
-    struct _node   *parent;
     struct _stack  *invalid;
     struct _edge   *edges;
+    struct _edge   *edgeTail;
     struct _node   *next;
-} _node;
+    struct _node   *cellNext;
+    struct _node   *pendingNext;
+    size_t          placed;
+    long            cell[3];
+    double          ecef[3];
+};
 
 struct _edge
 {
-    double          weight;
-    bool            visited;
     struct _node   *node;
     struct _edge   *next;
-} _edge;
+};
 
 struct _stack
 {
     struct _node   *node;
     struct _stack  *next;
-} _stack;
-
-// Initializing Static Functions
+};
 
-// Dijkstra Algorithm
-static void     _dijktra(
-    struct _stack *stack,
-    struct _edge *edge,
-    size_t * totalNodes);
+// The graph frozen into compressed sparse rows once ingestion is done
+struct _csr
+{
+    size_t          nodes;
+    size_t          blocked;
+    struct _node  **order;
+    bool           *invalid;
+    size_t         *first;
+    size_t         *adjacent;
+};
+
+// Depth first search state for splitting the graph into blocks
+struct _bcc
+{
+    struct _csr    *csr;
+    size_t          time;
+    size_t          top;
+    size_t         *cursor;
+    size_t         *disc;
+    size_t         *low;
+    size_t         *path;
+    size_t         *stack;
+    size_t         *score;
+    bool           *kept;
+};
+
+// Nodes sharing a latitude row, longitude column and altitude band
+struct _cell
+{
+    long            key[3];
+    struct _node   *members;
+    struct _cell   *next;
+};
 
-// Returning the smallest stack of bad nodes after analyzing a given stack
-static struct _stack *_smallestBadStack(
-    graph g,
-    struct _node *n);
+// Initializing Static Functions
 
-// Analyzing the graph
-static void     _analyzeGraph(
+// Freezing the nodes with GPS data and their edges into rows, nothing is
+// allocated when no node has any
+static bool     _freezeGraph(
     graph g,
-    struct _node *start,
-    struct _node *end,
-    struct _stack *badZerg,
-    size_t * badZergSz);
+    struct _csr *c);
+
+// Freeing the frozen rows
+static void     _freeCsr(
+    struct _csr *c);
+
+// Allocating the search state for the frozen graph
+static bool     _buildBlocks(
+    struct _csr *c,
+    struct _bcc *b);
+
+// Freeing the search state
+static void     _freeBlocks(
+    struct _bcc *b);
+
+// Finding the biconnected blocks reachable from root
+static size_t   _findBlocks(
+    struct _bcc *b,
+    size_t root,
+    bool rooted);
+
+// Handling a block that has just been split off below node u
+static size_t   _popBlock(
+    struct _bcc *b,
+    size_t u,
+    size_t v,
+    size_t root,
+    bool rooted);
+
+// Finding the first usable neighbor that can be kept as a pair with s
+static size_t   _pairNode(
+    struct _csr *c,
+    size_t s);
 
 // Verifying if an edge can be made
 static void     _validEdge(
+    graph g,
     struct _node *a,
     struct _node *b);
 
-// Checking if the edge and node are adjacent
-static bool     _notAdjacent(
-    struct _edge *e,
-    struct _node *n);
-
 // Printing bad nodes
 static void     _printBadNodes(
     struct _stack *s);
@@ -94,75 +183,101 @@ static void     _printLowHP(
     int limit,
     bool isLow);
 
+// Checking if a node's HP percentage is at or below the limit
+static bool     _isLowHP(
+    struct _node *n,
+    int limit);
+
 // Adding an edge between nodes
 static void     _addEdge(
+    graph g,
     struct _node *a,
-    struct _node *b,
-    double weight);
+    struct _node *b);
 
 // Creating and returning a stack
 static struct _stack *_createStack(
+    graph g,
     struct _node *n);
 
 // Adding a node to the stack
 static void     _addToStack(
+    graph g,
     struct _stack *s,
     struct _node *n);
 
-// Finding and returning a node with the matching id
-static struct _node *_findNode(
-    struct _node *n,
-    unsigned int id);
+// Adding a node to the end of the node chain
+static void     _linkNode(
+    graph g,
+    struct _node *n);
+
+// Returning the longitude columns in a latitude row of the grid
+static long     _gridColumns(
+    long row);
+
+// Hashing a grid cell key
+static size_t   _cellHash(
+    const long key[3]);
+
+// Returning the grid cell with the given key
+static struct _cell *_gridFind(
+    graph g,
+    const long key[3]);
+
+// Adding a node with GPS data to the grid
+static void     _gridAdd(
+    graph g,
+    struct _node *n);
+
+// Collecting the nodes in the 27 cells around a node, in chain order
+static size_t   _gridNearby(
+    graph g,
+    struct _node *n);
+
+// Comparing nodes by their place on the node chain
+static int      _compareOrder(
+    const void *a,
+    const void *b);
 
-// Setting a heavy edge for nodes with 3+ edges
-static void     _setHeavyEdges(
-    struct _edge *e);
+// Adding edges between a node and every node placed on the grid before it
+static void     _nodeEdges(
+    graph g,
+    struct _node *n);
 
-// Setting GPS info
+// Setting GPS info, out of bounds GPS is counted and left off
 static bool     _setGPS(
+    graph g,
     struct _node *n,
     struct gpsH *gps);
 
-// Marking the edge as visited
-static void     _setEdgeVisited(
-    struct _edge *e,
-    struct _node *n);
-
 // Setting the node data
 static bool     _setNodeData(
+    graph g,
     struct _node *n,
-    union zergH *zHead,
+    const union zergH *zHead,
     struct gpsH *gps);
 
-// Reseting the node data
-static void     _resetNodes(
-    struct _node *n,
-    bool full);
-
-// Reseting the edge data
-static void     _resetEdges(
-    struct _edge *e);
+// Adding GPS data for a zerg, making its node if it is new
+static int      _addNode(
+    graph g,
+    const union zergH *zHead,
+    struct gpsH *gps);
 
-// Removing bad nodes
-static void     _removeBadNodes(
-    struct _node *n);
+// Adding a status for a zerg, making its node if it is new
+static int      _addStatus(
+    graph g,
+    const union zergH *zHead,
+    const struct statusH *status);
 
 // Freeing a stack
 static void     _freeStack(
+    graph g,
     struct _stack *s);
 
-// Disabling a route for Dijkstra
-static void     _disableRoute(
-    struct _node *n);
-
-// Freeing nodes and all their data
-static void     _destroyNodes(
+// Freeing a node and all its data
+static void     _freeNode(
+    graph g,
     struct _node *n);
 
-// Freeing Edges
-static void     _destroyEdges(
-    struct _edge *e);
-
 // Creating and returning a graph
 graph
 graphCreate(
@@ -170,15 +285,25 @@ graphCreate(
 {
     graph           g = calloc(1, sizeof(*g));
 
-    g->badNodes = NULL;
-    g->totalBad = 0;
-    g->totalNodes = 0;
-    g->totalEdges = 0;
     if (!g)
     {
         return NULL;
     }
 
+    g->badNodes = NULL;
+    g->totalBad = 0;
+    g->totalNodes = 0;
+    g->totalEdges = 0;
+    g->totalInvalid = 0;
+
+    // Every node, edge and record is carved out of the graph's arenas
+    arenaInit(&g->nodeArena, "nodes", sizeof(struct _node));
+    arenaInit(&g->edgeArena, "edges", sizeof(struct _edge));
+    arenaInit(&g->stackArena, "stacks", sizeof(struct _stack));
+    arenaInit(&g->gpsArena, "gps", sizeof(struct gpsH));
+    arenaInit(&g->statusArena, "status", sizeof(struct statusH));
+    arenaInit(&g->cellArena, "cells", sizeof(struct _cell));
+
     return g;
 }
 
@@ -189,169 +314,236 @@ graphAddNode(
     union zergH zHead,
     struct gpsH *gps)
 {
-    int             err = 0;
-
     if (!g)
     {
-        return err;
+        return 0;
     }
 
-    // Adding to the node counter
-    g->totalNodes++;
+    return _addNode(g, &zHead, gps);
+}
 
-    //If nodes exist make the first one
-    if (!g->nodes)
+// Adding a status to a node
+int
+graphAddStatus(
+    graph g,
+    union zergH zHead,
+    struct statusH status)
+{
+    if (!g)
     {
-        g->nodes = calloc(1, sizeof(*g->nodes));
-        if (!g->nodes)
-        {
-            return err;
-        }
-
-        // Setting node data
-        g->nodes->next = NULL;
-        if (_setNodeData(g->nodes, &zHead, gps))
-        {
-            printf("Skipping node, out of bounds payload!\n");
-            free(g->nodes);
-            g->nodes = NULL;
-        }
-        return err;
+        return 0;
     }
 
-    // Adding a new node on the chain
-    struct _node   *curNode = g->nodes;
-    struct _node   *newNode = _findNode(g->nodes, zHead.details.source);
-    bool            new = true;
+    return _addStatus(g, &zHead, &status);
+}
+
+/*
+ * Nodes are found through the id index, so duplicates are caught without
+ * sorting the records by id first. They are added in the order they were
+ * read since that is the node chain order the analysis breaks ties with.
+ */
 
-    // If the node was not found make a new one
-    if (!newNode)
-    {
-        newNode = calloc(1, sizeof(*newNode));
-        if (!newNode)
-        {
-            return err;
-        }
-        // Setting node data
-        if (_setNodeData(newNode, &zHead, gps))
-        {
-            printf("Skipping node, out of bounds payload!\n");
-            free(newNode);
-            return err;
-        }
-        newNode->next = NULL;
-    }
-    // If the node was found
-    else
+// Adding decoded records in order, up to and including the first one with a
+// duplicate id. errs, if not NULL, gets the code graphAddNode or
+// graphAddStatus would have returned for each record that was added. Returns
+// 2 if it stopped on a duplicate and 0 otherwise
+int
+graphAddBatch(
+    graph g,
+    struct zergRecord *recs,
+    size_t count,
+    int *errs)
+{
+    int             err = 0;
+
+    for (size_t i = 0; g && i < count && err != 2; i++)
     {
-        // If the node already has gps data, error out
-        if (newNode->data.gps)
+        switch (getZType(&recs[i].zHead))
         {
-            return 2;
+        case ZERGSTATUS:
+            err = _addStatus(g, &recs[i].zHead, &recs[i].payload.status);
+            break;
+        case ZERGGPS:
+            err = _addNode(g, &recs[i].zHead, &recs[i].payload.gps);
+            break;
+        default:
+            err = 0;
+            break;
         }
 
-        // Setting gps data
-        if (_setGPS(newNode, gps))
+        if (errs)
         {
-            free(newNode);
-            return 2;
+            errs[i] = err;
         }
-        new = false;
     }
 
-    // Adding edges
-    _validEdge(newNode, curNode);
+    return err == 2 ? 2 : 0;
+}
+
+/*
+ * Deferred nodes are only placed on the grid and queued, so ingest doesn't
+ * stop to search the grid for every record. When the edges are built the
+ * queue is walked in the order the nodes got GPS data, so every node is
+ * paired with the same earlier nodes in the same order as it would have
+ * been when it arrived.
+ */
 
-    // Making sure the current node doesn't have the same id as the new node
-    if (newNode->data.zHead.details.source ==
-        curNode->data.zHead.details.source && new)
+// Setting whether edges are added as nodes arrive or only once
+// graphBuildEdges is called, switching back builds any that are waiting
+void
+graphDeferEdges(
+    graph g,
+    bool defer)
+{
+    if (!g)
     {
-        err = 2;
-        return err;
+        return;
     }
 
-    // Making sure we are at the last node on the chain
-    while (curNode->next)
-    {
-        // Making sure the current node doesn't have the same id as the new node
-        if (newNode->data.zHead.details.source ==
-            curNode->data.zHead.details.source && new)
-        {
-            err = 2;
-        }
-        curNode = curNode->next;
+    graphBuildEdges(g);
+    g->deferEdges = defer;
+}
 
-        // Adding edges
-        _validEdge(newNode, curNode);
+// Adding the edges for every node waiting on them, every function reading
+// edges calls this first
+void
+graphBuildEdges(
+    graph g)
+{
+    if (!g || !g->pending)
+    {
+        return;
     }
 
-    // If it was a new node, add it to the end of the node chain
-    if (new)
+    while (g->pending)
     {
-        curNode->next = newNode;
-    }
+        struct _node   *n = g->pending;
 
-    return err;
+        g->pending = n->pendingNext;
+        n->pendingNext = NULL;
+        _nodeEdges(g, n);
+    }
+    g->pendingTail = NULL;
 }
 
-// Adding a status to a node
-int
-graphAddStatus(
-    graph g,
-    union zergH zHead,
-    struct statusH status)
-{
-    int             err = 0;
+/*
+ * A start keeps every zerg with two independent paths to it. By Menger's
+ * theorem those are exactly the zerg that share a biconnected block of
+ * three or more nodes with the start, so one pass over the blocks scores
+ * every usable start in O(V + E). Only the start is held to that, two kept
+ * zerg in different blocks around it reach each other through the start
+ * alone. Nodes that
+ * are too close to another are never usable, except as the start, where
+ * a block search rooted at them is run only while they could still win.
+ * A start can always keep one neighbor as a lone pair. The start with the
+ * fewest removals wins, the earliest on the chain breaking ties.
+ */
 
-    if (!g)
+// Analyzing the graph for bad nodes
+void
+graphAnalyzeGraph(
+    graph g)
+{
+    if (!g || !g->nodes)
     {
-        return err;
+        return;
     }
 
-    struct _node   *found = NULL;
+    graphBuildEdges(g);
 
-    // If the node wasn't found
-    if (!(found = _findNode(g->nodes, zHead.details.source)))
+    struct _csr     c;
+    struct _bcc     b;
+    size_t          best;
+    size_t          bestStart = 0;
+
+    _freeStack(g, g->badNodes);
+    g->badNodes = NULL;
+    g->totalBad = 0;
+
+    if (_freezeGraph(g, &c))
     {
-        // Make a new node
-        graphAddNode(g, zHead, NULL);
-        return graphAddStatus(g, zHead, status);
+        g->outOfMemory = true;
+        return;
+    }
+    // Without a zerg that has a position there is no start to keep
+    if (!c.nodes)
+    {
+        return;
+    }
+    if (_buildBlocks(&c, &b))
+    {
+        g->outOfMemory = true;
+        _freeCsr(&c);
+        return;
     }
 
-    // If a node was found, but there is no status
-    if (!(found->data.status))
+    // Scoring every usable start in a single traversal
+    for (size_t v = 0; v < c.nodes; v++)
     {
-        // Making the status variable
-        found->data.status = calloc(1, sizeof(*found->data.status));
-        if (!found->data.status)
+        if (!b.disc[v] && !c.invalid[v])
         {
-            return err;
+            _findBlocks(&b, v, false);
         }
     }
-    // If there already is a status, error out
-    else
+
+    // Finding the start that needs the fewest removals
+    best = c.nodes;
+    for (size_t s = 0; s < c.nodes && best; s++)
     {
-        err = 2;
+        size_t          good = b.score[s];
+
+        // Every other too close node goes, so those starts rarely win
+        if (c.invalid[s])
+        {
+            if (c.blocked - 1 >= best)
+            {
+                continue;
+            }
+            memset(b.disc, 0, c.nodes * sizeof(*b.disc));
+            memset(b.kept, 0, c.nodes * sizeof(*b.kept));
+            good = _findBlocks(&b, s, true);
+        }
+
+        // Two zerg with an edge between them are always fine on their own
+        if (!good && _pairNode(&c, s) != SIZE_MAX)
+        {
+            good = 1;
+        }
+
+        if (c.nodes - 1 - good < best)
+        {
+            best = c.nodes - 1 - good;
+            bestStart = s;
+        }
     }
 
-    // Adding the status
-    *found->data.status = status;
+    // Keeping the removals for the best start in chain order
+    struct _stack **tail = &g->badNodes;
 
-    return err;
-}
+    memset(b.disc, 0, c.nodes * sizeof(*b.disc));
+    memset(b.kept, 0, c.nodes * sizeof(*b.kept));
+    if (best && !_findBlocks(&b, bestStart, true) &&
+        _pairNode(&c, bestStart) != SIZE_MAX)
+    {
+        b.kept[_pairNode(&c, bestStart)] = true;
+    }
+    b.kept[bestStart] = true;
 
-// Analyzing the graph for bad nodes
-void
-graphAnalyzeGraph(
-    graph g)
-{
-    if (!g || !g->nodes)
+    for (size_t v = 0; v < c.nodes && best; v++)
     {
-        return;
+        if (!b.kept[v])
+        {
+            if (!(*tail = _createStack(g, c.order[v])))
+            {
+                break;
+            }
+            tail = &(*tail)->next;
+        }
     }
+    g->totalBad = best;
 
-    // Getting the smallest amount of bad nodes to remove
-    g->badNodes = _smallestBadStack(g, g->nodes);
+    _freeBlocks(&b);
+    _freeCsr(&c);
 }
 
 // Printing bad nodes
@@ -399,190 +591,203 @@ graphPrintLowHP(
     _printLowHP(g->nodes, limit, false);
 }
 
-// Removing incomplete nodes
-void
-graphRemoveBadNodes(
+// Returning if more than half the nodes would have to be removed
+bool
+graphTooManyChanges(
     graph g)
 {
-    if (!g || !g->nodes)
-    {
-        return;
-    }
+    return g && g->totalBad > (g->totalNodes / 2);
+}
 
-    _removeBadNodes(g->nodes);
+// Copying up to max ids of the nodes to remove, returns how many there are
+size_t
+graphBadIds(
+    graph g,
+    unsigned int *ids,
+    size_t max)
+{
+    size_t          count = 0;
 
-    // If node has no GPS data, remove it
-    if (!g->nodes->data.gps)
+    if (!g)
     {
-        struct _node   *freeMe = g->nodes;
-
-        g->nodes = g->nodes->next;
-        g->totalNodes--;
-
-        _destroyNodes(freeMe);
+        return 0;
     }
-}
 
-// Freeing the graph
-void
-graphDestroy(
-    graph g)
-{
-    if (!g)
+    for (struct _stack * s = g->badNodes; s && s->node; s = s->next)
     {
-        return;
+        if (count < max)
+        {
+            ids[count] = s->node->data.zHead.details.source;
+        }
+        count++;
     }
 
-    _destroyNodes(g->nodes);
-    _freeStack(g->badNodes);
-    free(g);
+    return count;
 }
 
-// Analyzing the graph
-static void
-_analyzeGraph(
+// Copying up to max ids of the nodes at or below limit HP, returns how many
+// there are
+size_t
+graphLowHPIds(
     graph g,
-    struct _node *start,
-    struct _node *end,
-    struct _stack *badZerg,
-    size_t * badZergSz)
+    int limit,
+    unsigned int *ids,
+    size_t max)
 {
-    if (!g || !start || !end || !badZerg || !badZergSz)
+    size_t          count = 0;
+
+    if (!g)
     {
-        return;
+        return 0;
     }
 
-    // Skipping nodes that are scanning for itself but have invalid items
-    if (start->data.zHead.details.source == end->data.zHead.details.source)
+    for (struct _node * n = g->nodes; n; n = n->next)
     {
-        _analyzeGraph(g, start, end->next, badZerg, badZergSz);
-        return;
+        if (_isLowHP(n, limit))
+        {
+            if (count < max)
+            {
+                ids[count] = n->data.zHead.details.source;
+            }
+            count++;
+        }
     }
 
-    struct _stack  *s = _createStack(start);
+    return count;
+}
 
-    size_t          totalNodes = 1;
+// Returning if an allocation failed since the graph was created, whatever
+// was being added or analyzed then is missing from it
+bool
+graphOutOfMemory(
+    graph g)
+{
+    return g && g->outOfMemory;
+}
 
-    // Reseting all stats on nodes
-    _resetNodes(g->nodes, true);
-    for (int i = 0; i < 2; i++)
+// Removing incomplete nodes
+void
+graphRemoveBadNodes(
+    graph g)
+{
+    if (!g || !g->nodes)
     {
-        // Setting starting node info
-        s->node->weight = 0;
-        s->node->parent = NULL;
+        return;
+    }
 
-        _dijktra(s, s->node->edges, &totalNodes);
+    struct _node  **link = &g->nodes;
 
-        // Disabling a known fastest path
-        _disableRoute(end);
+    g->tail = NULL;
+    while (*link)
+    {
+        struct _node   *n = *link;
 
-        // Adding bad items to the stack
-        if ((!end->parent) &&
-            ((_notAdjacent(s->node->edges, end) &&
-              (totalNodes - *badZergSz > 2)) ||
-             (!_notAdjacent(s->node->edges, end) &&
-              (totalNodes - *badZergSz > 3))))
+        // If node has no GPS data, remove it
+        if (!n->data.gps)
         {
-            // Creating the first item on the stack
-            if (!badZerg->node)
-            {
-                badZerg->next = _createStack(NULL);
-                badZerg->node = end;
-            }
-            // Adding to the stack
-            else
-            {
-                _addToStack(badZerg, end);
-            }
-            (*badZergSz)++;
+            *link = n->next;
+            g->index[n->data.zHead.details.source] = NULL;
+            g->totalNodes--;
 
-            break;
+            _freeNode(g, n);
+            continue;
         }
 
-        // Light Reset on nodes
-        _resetNodes(g->nodes, false);
+        g->tail = n;
+        link = &n->next;
     }
+}
 
-    free(s);
-
-    // Going to the next stack place if an item was added
-    if (badZerg->next)
+// Printing the arena allocations made for the graph
+void
+graphPrintAllocs(
+    graph g,
+    FILE * fp)
+{
+    if (!g)
     {
-        _analyzeGraph(g, start, end->next, badZerg->next, badZergSz);
         return;
     }
 
-    _analyzeGraph(g, start, end->next, badZerg, badZergSz);
+    graphBuildEdges(g);
+    arenaPrint(&g->nodeArena, fp);
+    arenaPrint(&g->edgeArena, fp);
+    arenaPrint(&g->stackArena, fp);
+    arenaPrint(&g->gpsArena, fp);
+    arenaPrint(&g->statusArena, fp);
+    arenaPrint(&g->cellArena, fp);
 }
 
-// Returning the smallest stack of bad nodes after analyzing a given stack
-static struct _stack *
-_smallestBadStack(
+// Counting the objects handed out and blocks allocated by the graph's arenas
+void
+graphAllocCounts(
     graph g,
-    struct _node *n)
+    size_t * objects,
+    size_t * blocks)
 {
-    if (!g || !n)
-    {
-        return NULL;
-    }
-
-    // Making a stack and size counter
-    size_t          sz = 0;
-    struct _stack  *badS = _createStack(NULL);
+    struct arena   *arenas[] = { &g->nodeArena, &g->edgeArena,
+        &g->stackArena, &g->gpsArena, &g->statusArena, &g->cellArena
+    };
 
-    // Analyzing for bad nodes
-    _analyzeGraph(g, n, g->nodes, badS, &sz);
-
-    // Saving if the new stack is smaller
-    if ((sz < g->totalBad && sz != 0) || (g->totalBad == 0))
+    graphBuildEdges(g);
+    *objects = 0;
+    *blocks = 0;
+    for (size_t i = 0; i < sizeof(arenas) / sizeof(*arenas); i++)
     {
-        g->totalBad = sz;
+        *objects += arenas[i]->totalObjects;
+        *blocks += arenas[i]->totalBlocks;
     }
+}
 
-    // Recursively running itself
-    struct _stack  *returnS = _smallestBadStack(g, n->next);
-
-    // Returning current bad stack if it's the smallest
-    if (sz == g->totalBad)
-    {
-        if (returnS)
-        {
-            _freeStack(returnS);
-        }
-        return badS;
-    }
-    // Returning the new stack if that is smaller
-    else
-    {
-        _freeStack(badS);
-        return returnS;
-    }
+// Counting the nodes, edges and pairs too close to be edges in the graph
+void
+graphCounts(
+    graph g,
+    size_t * nodes,
+    size_t * edges,
+    size_t * invalid)
+{
+    graphBuildEdges(g);
+    *nodes = g->totalNodes;
+    *edges = g->totalEdges;
+    *invalid = g->totalInvalid;
+}
 
-    return NULL;
+// Counting the pairs of grid neighbors checked, how many of them the
+// prefilter threw out and how many needed the full haversine
+void
+graphPairCounts(
+    graph g,
+    size_t * pairs,
+    size_t * filtered,
+    size_t * exact)
+{
+    graphBuildEdges(g);
+    *pairs = g->totalPairs;
+    *filtered = g->totalFiltered;
+    *exact = g->totalExact;
 }
 
-// Removing bad nodes
-static void
-_removeBadNodes(
-    struct _node *n)
+// Freeing the graph
+void
+graphDestroy(
+    graph g)
 {
-    if (!n || !n->next)
+    if (!g)
     {
         return;
     }
 
-    _removeBadNodes(n->next);
-
-    // Removing nodes without gps data
-    if (!n->next->data.gps)
-    {
-        struct _node   *freeMe = n->next;
-
-        n->next = n->next->next;
-
-        freeMe->next = NULL;
-        _destroyNodes(freeMe);
-    }
+    arenaRelease(&g->nodeArena);
+    arenaRelease(&g->edgeArena);
+    arenaRelease(&g->stackArena);
+    arenaRelease(&g->gpsArena);
+    arenaRelease(&g->statusArena);
+    arenaRelease(&g->cellArena);
+    free(g->cells);
+    free(g->nearby);
+    chordFree(&g->block);
+    free(g);
 }
 
 // Printing nodes with low HP
@@ -598,9 +803,7 @@ _printLowHP(
     }
 
     // If the HP percentage is below or equal to the limit
-    if (!n->data.status ||
-        ((((float) n->data.status->hp / n->data.status->maxHp) * 100) <=
-         limit))
+    if (_isLowHP(n, limit))
     {
         // If this is the first low HP item
         if (!isLow)
@@ -614,9 +817,21 @@ _printLowHP(
     _printLowHP(n->next, limit, isLow);
 }
 
-// Setting GPS info
+// Checking if a node's HP percentage is at or below the limit
+static bool
+_isLowHP(
+    struct _node *n,
+    int limit)
+{
+    return !n->data.status ||
+        ((((float) n->data.status->hp / n->data.status->maxHp) * 100) <=
+         limit);
+}
+
+// Setting GPS info, out of bounds GPS is counted and left off
 static bool
 _setGPS(
+    graph g,
     struct _node *n,
     struct gpsH *gps)
 {
@@ -630,18 +845,22 @@ _setGPS(
     // GPS bounds checks
     if (notValidGPS(gps))
     {
+        diagReport(DIAG_BOUNDS);
         return true;
     }
 
     // Making the gps variable
-    n->data.gps = calloc(1, sizeof(*n->data.gps));
+    n->data.gps = arenaAlloc(&g->gpsArena);
     if (!n->data.gps)
     {
+        g->outOfMemory = true;
         return true;
     }
 
     // Adding the gps data
     *n->data.gps = *gps;
+    chordPoint(gps->latitude, gps->longitude, gps->altitude, n->ecef);
+    g->highest = fmax(g->highest, fabs(gps->altitude));
 
     return false;
 }
@@ -649,8 +868,9 @@ _setGPS(
 // Setting the node data
 static bool
 _setNodeData(
+    graph g,
     struct _node *n,
-    union zergH *zHead,
+    const union zergH *zHead,
     struct gpsH *gps)
 {
     if (!n)
@@ -665,7 +885,7 @@ _setNodeData(
     if (gps)
     {
 
-        if (_setGPS(n, gps))
+        if (_setGPS(g, n, gps))
         {
             return true;
         }
@@ -674,120 +894,627 @@ _setNodeData(
     // Setting base values
     n->data.zHead = *zHead;
     n->edgeCount = 0;
-    n->visited = false;
-    n->weight = INITWEIGHT;
-    n->parent = NULL;
     n->invalid = NULL;
 
     return false;
 }
 
-// Finding and returning a node with the matching id
-static struct _node *
-_findNode(
-    struct _node *n,
-    unsigned int id)
+// Adding GPS data for a zerg, making its node if it is new
+static int
+_addNode(
+    graph g,
+    const union zergH *zHead,
+    struct gpsH *gps)
 {
-    if (!n)
+    struct _node   *newNode = g->index[zHead->details.source];
+    bool            new = !newNode;
+
+    // If the node was not found make a new one
+    if (new)
     {
-        return NULL;
+        newNode = arenaAlloc(&g->nodeArena);
+        if (!newNode)
+        {
+            g->outOfMemory = true;
+            return 0;
+        }
+        // Setting node data
+        if (_setNodeData(g, newNode, zHead, gps))
+        {
+            arenaFree(&g->nodeArena, newNode);
+            return 0;
+        }
+    }
+    // If the node was found
+    else
+    {
+        // If the node already has gps data, error out
+        if (newNode->data.gps)
+        {
+            return 2;
+        }
+
+        // Setting gps data
+        if (_setGPS(g, newNode, gps))
+        {
+            return 0;
+        }
     }
 
-    // Returning if node has the same id
-    if (n->data.zHead.details.source == id)
+    // Adding edges against every node close enough on the chain, or
+    // queueing the node to have them added all at once
+    if (newNode->data.gps)
     {
-        return n;
+        newNode->placed = g->totalPlaced++;
+        if (!g->deferEdges)
+        {
+            _nodeEdges(g, newNode);
+        }
+        else if (g->pendingTail)
+        {
+            g->pendingTail->pendingNext = newNode;
+            g->pendingTail = newNode;
+        }
+        else
+        {
+            g->pending = g->pendingTail = newNode;
+        }
+    }
+
+    // If it was a new node, add it to the end of the node chain
+    if (new)
+    {
+        _linkNode(g, newNode);
     }
+    _gridAdd(g, newNode);
 
-    // Going to the next node on the chain
-    return _findNode(n->next, id);
+    return 0;
 }
 
-// Disabling a route for Dijkstra
-static void
-_disableRoute(
-    struct _node *n)
+// Adding a status for a zerg, making its node if it is new
+static int
+_addStatus(
+    graph g,
+    const union zergH *zHead,
+    const struct statusH *status)
 {
-    if (!n)
+    int             err = 0;
+    struct _node   *found = g->index[zHead->details.source];
+
+    // If the node wasn't found
+    if (!found)
     {
-        return;
+        // Make a new node
+        _addNode(g, zHead, NULL);
+        if (!(found = g->index[zHead->details.source]))
+        {
+            return err;
+        }
     }
 
-    // If the node has a parent
-    if (n->parent)
+    // If a node was found, but there is no status
+    if (!(found->data.status))
     {
+        // Making the status variable
+        found->data.status = arenaAlloc(&g->statusArena);
+        if (!found->data.status)
+        {
+            g->outOfMemory = true;
+            return err;
+        }
+    }
+    // If there already is a status, error out
+    else
+    {
+        err = 2;
+    }
+
+    // Adding the status
+    *found->data.status = *status;
 
-        _setEdgeVisited(n->parent->edges, n);
+    return err;
+}
+
+// Freezing the nodes with GPS data and their edges into rows, nothing is
+// allocated when no node has any
+static bool
+_freezeGraph(
+    graph g,
+    struct _csr *c)
+{
+    size_t          edges = 0;
+
+    memset(c, 0, sizeof(*c));
+
+    // Giving each node a dense index in chain order
+    for (struct _node * n = g->nodes; n; n = n->next)
+    {
+        n->id = SIZE_MAX;
+        if (n->data.gps)
+        {
+            n->id = c->nodes++;
+            edges += n->edgeCount;
+            if (n->invalid)
+            {
+                c->blocked++;
+            }
+        }
+    }
+    if (!c->nodes)
+    {
+        return false;
+    }
+
+    c->order = calloc(c->nodes, sizeof(*c->order));
+    c->invalid = calloc(c->nodes, sizeof(*c->invalid));
+    c->first = calloc(c->nodes + 1, sizeof(*c->first));
+    c->adjacent = calloc(edges, sizeof(*c->adjacent));
+    if (!c->order || !c->invalid || !c->first || (edges && !c->adjacent))
+    {
+        _freeCsr(c);
+        return true;
     }
 
-    // If the node has a parent and grand parent
-    if (n->parent && n->parent->parent)
+    // Laying each node's edges out after the last, in list order
+    edges = 0;
+    for (struct _node * n = g->nodes; n; n = n->next)
     {
-        n->parent->visited = true;
+        if (n->id == SIZE_MAX)
+        {
+            continue;
+        }
+        c->order[n->id] = n;
+        c->invalid[n->id] = n->invalid != NULL;
+        c->first[n->id] = edges;
+        for (struct _edge * e = n->edges; e; e = e->next)
+        {
+            c->adjacent[edges] = e->node->id;
+            edges++;
+        }
     }
+    c->first[c->nodes] = edges;
 
-    _disableRoute(n->parent);
+    return false;
+}
+
+// Freeing the frozen rows
+static void
+_freeCsr(
+    struct _csr *c)
+{
+    free(c->order);
+    free(c->invalid);
+    free(c->first);
+    free(c->adjacent);
 }
 
-// Checking if the edge and node are adjacent
+// Allocating the search state for the frozen graph
 static bool
-_notAdjacent(
-    struct _edge *e,
-    struct _node *n)
+_buildBlocks(
+    struct _csr *c,
+    struct _bcc *b)
 {
-    if (!e || !n)
-    {
+    memset(b, 0, sizeof(*b));
+    b->csr = c;
+
+    b->cursor = calloc(c->nodes, sizeof(*b->cursor));
+    b->disc = calloc(c->nodes, sizeof(*b->disc));
+    b->low = calloc(c->nodes, sizeof(*b->low));
+    b->path = calloc(c->nodes, sizeof(*b->path));
+    b->stack = calloc(c->nodes, sizeof(*b->stack));
+    b->score = calloc(c->nodes, sizeof(*b->score));
+    b->kept = calloc(c->nodes, sizeof(*b->kept));
+    if (!b->cursor || !b->disc || !b->low || !b->path || !b->stack ||
+        !b->score || !b->kept)
+    {
+        _freeBlocks(b);
         return true;
     }
 
-    // If the edge is connected to the node
-    if (e->node->data.zHead.details.source == n->data.zHead.details.source)
+    return false;
+}
+
+// Freeing the search state
+static void
+_freeBlocks(
+    struct _bcc *b)
+{
+    free(b->cursor);
+    free(b->disc);
+    free(b->low);
+    free(b->path);
+    free(b->stack);
+    free(b->score);
+    free(b->kept);
+}
+
+/*
+ * Iterative Hopcroft-Tarjan over the usable nodes. Unrooted, every block
+ * of three or more nodes adds its size less one to the score of each of
+ * its members. Rooted, only the blocks holding root are marked as kept,
+ * which lets a too close node be searched from as a start.
+ */
+
+// Finding the biconnected blocks reachable from root
+static size_t
+_findBlocks(
+    struct _bcc *b,
+    size_t root,
+    bool rooted)
+{
+    struct _csr    *c = b->csr;
+    size_t          depth = 0;
+    size_t          kept = 0;
+
+    b->disc[root] = b->low[root] = ++b->time;
+    b->cursor[root] = c->first[root];
+    b->stack[b->top++] = root;
+    b->path[depth++] = root;
+
+    while (depth)
     {
-        return false;
+        size_t          v = b->path[depth - 1];
+
+        // Walking the next edge of the deepest node
+        if (b->cursor[v] < c->first[v + 1])
+        {
+            size_t          w = c->adjacent[b->cursor[v]++];
+
+            if (w != root && c->invalid[w])
+            {
+                continue;
+            }
+
+            if (!b->disc[w])
+            {
+                b->disc[w] = b->low[w] = ++b->time;
+                b->cursor[w] = c->first[w];
+                b->stack[b->top++] = w;
+                b->path[depth++] = w;
+            }
+            else if (b->disc[w] < b->low[v])
+            {
+                b->low[v] = b->disc[w];
+            }
+            continue;
+        }
+
+        // Backing up, the parent cuts off a block if v can't get above it
+        if (--depth)
+        {
+            size_t          u = b->path[depth - 1];
+
+            if (b->low[v] < b->low[u])
+            {
+                b->low[u] = b->low[v];
+            }
+            if (b->low[v] >= b->disc[u])
+            {
+                kept += _popBlock(b, u, v, root, rooted);
+            }
+        }
     }
 
-    return _notAdjacent(e->next, n);
+    // Leaving only the root, a node on its own is its own block
+    b->top--;
+
+    return kept;
 }
 
-// Printing bad nodes
+// Handling a block that has just been split off below node u
+static size_t
+_popBlock(
+    struct _bcc *b,
+    size_t u,
+    size_t v,
+    size_t root,
+    bool rooted)
+{
+    size_t          bottom = b->top;
+    size_t          size;
+    size_t          kept = 0;
+
+    do
+    {
+        bottom--;
+    }
+    while (b->stack[bottom] != v);
+    size = b->top - bottom + 1;
+
+    // Two nodes joined by a single edge only have one path
+    if (size >= 3)
+    {
+        if (!rooted)
+        {
+            b->score[u] += size - 1;
+        }
+        for (size_t i = bottom; i < b->top; i++)
+        {
+            if (!rooted)
+            {
+                b->score[b->stack[i]] += size - 1;
+            }
+            else if (u == root)
+            {
+                b->kept[b->stack[i]] = true;
+                kept++;
+            }
+        }
+    }
+    b->top = bottom;
+
+    return kept;
+}
+
+// Finding the first usable neighbor that can be kept as a pair with s
+static size_t
+_pairNode(
+    struct _csr *c,
+    size_t s)
+{
+    size_t          pair = SIZE_MAX;
+
+    for (size_t i = c->first[s]; i < c->first[s + 1]; i++)
+    {
+        if (!c->invalid[c->adjacent[i]] && c->adjacent[i] < pair)
+        {
+            pair = c->adjacent[i];
+        }
+    }
+
+    return pair;
+}
+
+// Adding a node to the end of the node chain
 static void
-_printBadNodes(
-    struct _stack *s)
+_linkNode(
+    graph g,
+    struct _node *n)
 {
-    if (!s || !s->node)
+    n->next = NULL;
+    if (!g->nodes)
     {
-        return;
+        g->nodes = n;
     }
+    else
+    {
+        g->tail->next = n;
+    }
+    g->tail = n;
+    g->index[n->data.zHead.details.source] = n;
+    g->totalNodes++;
+    n->order = g->totalOrder++;
+}
 
-    printf("Remove zerg #%u\n", s->node->data.zHead.details.source);
+/*
+ * The grid is laid out so that two nodes within EDGEDIST of each other
+ * are always in neighboring cells. Rows are CELLANGLE of latitude tall,
+ * and haversine can't move less in latitude than that. Columns are
+ * sized per row so that even at the most poleward latitude a neighbor
+ * row can reach, CELLANGLE of great circle is under one column of
+ * longitude. Altitude bands are EDGEDIST tall since the altitude
+ * difference is part of the true distance.
+ */
+
+// Returning the longitude columns in a latitude row of the grid
+static long
+_gridColumns(
+    long row)
+{
+    double          edge = fmax(fabs(row * CELLANGLE),
+                                fabs((row + 1) * CELLANGLE)) + CELLANGLE;
+    double          ratio = sin(CELLANGLE / 2) / cos(edge);
 
-    _printBadNodes(s->next);
+    // Close to the poles the whole row is a single column
+    if (edge >= PI / 2 || ratio >= 1)
+    {
+        return 1;
+    }
+
+    return (long) floor((2 * PI) / (2 * asin(ratio)));
 }
 
-// Marking the edge as visited
+// Hashing a grid cell key
+static size_t
+_cellHash(
+    const long key[3])
+{
+    return ((size_t) key[0] * 73856093) ^ ((size_t) key[1] * 19349663) ^
+        ((size_t) key[2] * 83492791);
+}
+
+// Returning the grid cell with the given key
+static struct _cell *
+_gridFind(
+    graph g,
+    const long key[3])
+{
+    if (!g->cells)
+    {
+        return NULL;
+    }
+
+    for (struct _cell * c = g->cells[_cellHash(key) % g->cellBuckets]; c;
+         c = c->next)
+    {
+        if (c->key[0] == key[0] && c->key[1] == key[1] &&
+            c->key[2] == key[2])
+        {
+            return c;
+        }
+    }
+
+    return NULL;
+}
+
+// Adding a node with GPS data to the grid
 static void
-_setEdgeVisited(
-    struct _edge *e,
+_gridAdd(
+    graph g,
     struct _node *n)
 {
-    if (!e || !n)
+    if (!n->data.gps)
     {
         return;
     }
 
-    // If the edge is connected to the node
-    if (e->node->data.zHead.details.source == n->data.zHead.details.source)
+    double          lat = n->data.gps->latitude * TO_RAD;
+    double          lon = n->data.gps->longitude * TO_RAD;
+    long            columns;
+
+    n->cell[0] = (long) floor(lat / CELLANGLE);
+    columns = _gridColumns(n->cell[0]);
+    n->cell[1] = (long) floor((lon + PI) / (2 * PI) * columns) % columns;
+    n->cell[2] = (long) floor(n->data.gps->altitude / EDGEDIST);
+
+    struct _cell   *c = _gridFind(g, n->cell);
+
+    // Making a new cell, growing the table when it gets crowded
+    if (!c)
+    {
+        if (g->totalCells >= g->cellBuckets)
+        {
+            size_t          buckets =
+                g->cellBuckets ? g->cellBuckets * 2 : INITCELLS;
+            struct _cell  **cells = calloc(buckets, sizeof(*cells));
+
+            if (!cells)
+            {
+                g->outOfMemory = true;
+                return;
+            }
+            for (size_t i = 0; i < g->cellBuckets; i++)
+            {
+                while (g->cells[i])
+                {
+                    struct _cell   *move = g->cells[i];
+                    size_t          hash = _cellHash(move->key);
+
+                    g->cells[i] = move->next;
+                    move->next = cells[hash % buckets];
+                    cells[hash % buckets] = move;
+                }
+            }
+            free(g->cells);
+            g->cells = cells;
+            g->cellBuckets = buckets;
+        }
+
+        c = arenaAlloc(&g->cellArena);
+        if (!c)
+        {
+            g->outOfMemory = true;
+            return;
+        }
+        memcpy(c->key, n->cell, sizeof(c->key));
+        c->next = g->cells[_cellHash(c->key) % g->cellBuckets];
+        g->cells[_cellHash(c->key) % g->cellBuckets] = c;
+        g->totalCells++;
+    }
+
+    n->cellNext = c->members;
+    c->members = n;
+}
+
+// Collecting the nodes in the 27 cells around a node, in chain order
+static size_t
+_gridNearby(
+    graph g,
+    struct _node *n)
+{
+    double          lat = n->data.gps->latitude * TO_RAD;
+    double          lon = n->data.gps->longitude * TO_RAD;
+    long            row = (long) floor(lat / CELLANGLE);
+    long            band = (long) floor(n->data.gps->altitude / EDGEDIST);
+    size_t          found = 0;
+
+    for (long r = row - 1; r <= row + 1; r++)
+    {
+        long            columns = _gridColumns(r);
+        long            col = (long) floor((lon + PI) / (2 * PI) * columns);
+        long            first = col - 1;
+        long            last = col + 1;
+
+        // Narrow rows wrap onto themselves, so just visit every column
+        if (columns <= 3)
+        {
+            first = 0;
+            last = columns - 1;
+        }
+
+        for (long c = first; c <= last; c++)
+        {
+            for (long b = band - 1; b <= band + 1; b++)
+            {
+                long            key[3] =
+                    { r, ((c % columns) + columns) % columns, b };
+                struct _cell   *cell = _gridFind(g, key);
+
+                for (struct _node * m = cell ? cell->members : NULL; m;
+                     m = m->cellNext)
+                {
+                    // Growing the list of nearby nodes
+                    if (found == g->nearbySize)
+                    {
+                        size_t          size =
+                            g->nearbySize ? g->nearbySize * 2 : 64;
+                        struct _node  **nearby =
+                            realloc(g->nearby, size * sizeof(*nearby));
+
+                        if (!nearby)
+                        {
+                            g->outOfMemory = true;
+                            return found;
+                        }
+                        g->nearby = nearby;
+                        g->nearbySize = size;
+                    }
+                    g->nearby[found++] = m;
+                }
+            }
+        }
+    }
+
+    // Visiting nodes in the same order a full scan of the chain would
+    if (found > 1)
+    {
+        qsort(g->nearby, found, sizeof(*g->nearby), _compareOrder);
+    }
+
+    return found;
+}
+
+// Comparing nodes by their place on the node chain
+static int
+_compareOrder(
+    const void *a,
+    const void *b)
+{
+    const struct _node *x = *(struct _node * const *) a;
+    const struct _node *y = *(struct _node * const *) b;
+
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+// Printing bad nodes
+static void
+_printBadNodes(
+    struct _stack *s)
+{
+    if (!s || !s->node)
     {
-        e->visited = true;
         return;
     }
 
-    _setEdgeVisited(e->next, n);
+    printf("Remove zerg #%u\n", s->node->data.zHead.details.source);
+
+    _printBadNodes(s->next);
 }
 
 // Adding a node to the stack
 static void
 _addToStack(
+    graph g,
     struct _stack *s,
     struct _node *n)
 {
@@ -799,9 +1526,10 @@ _addToStack(
     // Adding the node to the end of the stack
     if (!s->next)
     {
-        s->next = calloc(1, sizeof(*s->next));
+        s->next = arenaAlloc(&g->stackArena);
         if (!s->next)
         {
+            g->outOfMemory = true;
             return;
         }
         s->next->node = n;
@@ -809,18 +1537,20 @@ _addToStack(
         return;
     }
 
-    _addToStack(s->next, n);
+    _addToStack(g, s->next, n);
 }
 
 // Creating and returning a stack
 static struct _stack *
 _createStack(
+    graph g,
     struct _node *n)
 {
-    struct _stack  *s = calloc(1, sizeof(*s));
+    struct _stack  *s = arenaAlloc(&g->stackArena);
 
     if (!s)
     {
+        g->outOfMemory = true;
         return NULL;
     }
     s->node = n;
@@ -832,10 +1562,11 @@ _createStack(
 // Verifying if an edge can be made
 static void
 _validEdge(
+    graph g,
     struct _node *a,
     struct _node *b)
 {
-    if (!a || !b || !a->data.gps || !b->data.gps)
+    if (!a || !b || a == b || !a->data.gps || !b->data.gps)
     {
         return;
     }
@@ -843,77 +1574,80 @@ _validEdge(
     // Checking the Altitude Difference
     double          altDiff = a->data.gps->altitude - b->data.gps->altitude;
 
-    if (altDiff > 15.0000)
+    if (altDiff > EDGEDIST)
     {
         return;
     }
 
-    // Checking the true distance using Pythagorean theorem
-    double          trueDist =
-        sqrt(pow(dist(a->data.gps, b->data.gps), 2) + pow(altDiff, 2));
+    // The Earth centered distance is at most spread off the true one squared
+    double          d2 = chordDistance2(a->ecef, b->ecef);
+    double          spread = d2 *
+        chordError(a->data.gps->altitude, b->data.gps->altitude) +
+        CHORDSLACK * CHORDSLACK;
+    double          trueDist;
+
+    if (d2 - spread > EDGEDIST * EDGEDIST)
+    {
+        return;
+    }
+
+    // Checking the true distance using Pythagorean theorem only when the
+    // Earth centered one is too close to a limit to decide by
+    if (fabs(d2 - EDGEDIST * EDGEDIST) > spread &&
+        fabs(d2 - CLOSEDIST * CLOSEDIST) > spread)
+    {
+        trueDist = sqrt(d2);
+    }
+    else
+    {
+        trueDist =
+            sqrt(pow(dist(a->data.gps, b->data.gps), 2) + pow(altDiff, 2));
+        g->totalExact++;
+    }
 
     // If the distance is to long
-    if (trueDist > 15.0000)
+    if (trueDist > EDGEDIST)
     {
         return;
     }
     // If the distance is to short add it to invalid
-    else if (trueDist <= 1.1430)
+    else if (trueDist <= CLOSEDIST)
     {
         // Setting the invalid item on A
         if (!a->invalid)
         {
-            a->invalid = _createStack(b);
+            a->invalid = _createStack(g, b);
         }
         else
         {
-            _addToStack(a->invalid, b);
+            _addToStack(g, a->invalid, b);
         }
 
         // Setting the invalid item on B
         if (!b->invalid)
         {
-            b->invalid = _createStack(a);
+            b->invalid = _createStack(g, a);
         }
         else
         {
-            _addToStack(b->invalid, a);
+            _addToStack(g, b->invalid, a);
         }
-        a->visited = true;
-        b->visited = true;
+        g->totalInvalid++;
         return;
     }
 
     // Adding edges
-    _addEdge(a, b, trueDist);
-    _addEdge(b, a, trueDist);
-}
-
-// Setting a heavy edge for nodes with 3+ edges
-static void
-_setHeavyEdges(
-    struct _edge *e)
-{
-    if (!e)
-    {
-        return;
-    }
-
-    // Making the edge wait heavy if it has 3+ edges
-    if (e->node->edgeCount > 2)
-    {
-        e->weight = HEAVYEDGE;
-    }
-
-    _setHeavyEdges(e->next);
+    _addEdge(g, a, b);
+    _addEdge(g, b, a);
+    g->totalEdges++;
 }
 
 // Adding an edge between nodes
 static void
 _addEdge(
+    graph g,
     struct _node *a,
-    struct _node *b,
-    double weight)
+    struct _node *b)
 {
     if (!a || !b)
     {
@@ -921,201 +1655,115 @@ _addEdge(
     }
 
     // Making new edge
-    struct _edge   *newEdge = calloc(1, sizeof(*newEdge));
+    struct _edge   *newEdge = arenaAlloc(&g->edgeArena);
 
     if (!newEdge)
     {
+        g->outOfMemory = true;
         return;
     }
 
     // Tracking edges
     a->edgeCount++;
 
-    // Setting weight based off the node value
+    // Adding the edge to the end of the edges
     newEdge->node = b;
-    newEdge->weight = weight;
-    newEdge->visited = false;
-
     if (!a->edges)
     {
         a->edges = newEdge;
-        return;
-    }
-
-    struct _edge   *curEdge = a->edges;
-
-    // Making sure the edge it set at the end of the edges
-    while (curEdge->next)
-    {
-        // If node a and b have 3+ edges, make them heavy
-        if (a->edgeCount > 2 && curEdge->node->edgeCount > 2)
-        {
-            curEdge->weight = HEAVYEDGE;
-            _setHeavyEdges(curEdge->node->edges);
-        }
-        curEdge = curEdge->next;
     }
-
-    // If node a and b have 3+ edges, make them heavy
-    if (a->edgeCount > 2 && curEdge->node->edgeCount > 2)
+    else
     {
-        curEdge->weight = HEAVYEDGE;
-        _setHeavyEdges(curEdge->node->edges);
+        a->edgeTail->next = newEdge;
     }
-
-    curEdge->next = newEdge;
+    a->edgeTail = newEdge;
 }
 
-// Freeing a stack
+// Adding edges between a node and every node placed on the grid before it
 static void
-_freeStack(
-    struct _stack *s)
+_nodeEdges(
+    graph g,
+    struct _node *n)
 {
-    if (!s)
-    {
-        return;
-    }
-    _freeStack(s->next);
-    free(s);
-}
+    size_t          nearby = _gridNearby(g, n);
+    size_t          count = 0;
+    struct chordBlock *b = &g->block;
+    double          reach;
 
-// Dijkstra Algorithm
-static void
-_dijktra(
-    struct _stack *stack,
-    struct _edge *edge,
-    size_t * totalNodes)
-{
-    if (!edge || !stack || !totalNodes)
+    // Keeping the nodes placed before this one, still in chain order
+    for (size_t i = 0; i < nearby; i++)
     {
-        return;
-    }
-    // Making next stack
-    if (stack->next)
-    {
-        free(stack->next);
-        stack->next = NULL;
+        if (g->nearby[i]->placed < n->placed)
+        {
+            g->nearby[count++] = g->nearby[i];
+        }
     }
 
-    // Going to the next item if the edge or node is disabled
-    if (edge->visited || edge->node->visited)
-    {
-        _dijktra(stack, edge->next, totalNodes);
-        return;
-    }
+    g->totalPairs += count;
 
-    // If I haven't visited this node
-    if (edge->node->weight > (stack->node->weight + edge->weight))
+    // Without room for the prefilter every node gets the full check
+    if (chordReserve(b, count))
     {
-        stack->next = calloc(1, sizeof(_stack));
-        if (!stack->next)
+        for (size_t i = 0; i < count; i++)
         {
-            return;
-        }
-
-        if ((edge->node->weight - INITWEIGHT) >= 0.00)
-        {
-            (*totalNodes)++;
+            _validEdge(g, n, g->nearby[i]);
         }
-
-        // Adding stack data
-        edge->node->weight = (stack->node->weight + edge->weight);
-        edge->node->parent = stack->node;
-        stack->next->node = edge->node;
-
-        _dijktra(stack->next, stack->next->node->edges, totalNodes);
-
-        _dijktra(stack, stack->node->edges, totalNodes);
-
+        return;
     }
 
-    // If there is another edge
-    if (edge->next)
+    for (size_t i = 0; i < count; i++)
     {
-        // Going to the next edge
-        _dijktra(stack, edge->next, totalNodes);
-    }
-}
+        struct _node   *m = g->nearby[i];
 
-// Reseting the node data
-static void
-_resetNodes(
-    struct _node *n,
-    bool full)
-{
-    if (!n)
-    {
-        return;
+        b->x[i] = m->ecef[0];
+        b->y[i] = m->ecef[1];
+        b->z[i] = m->ecef[2];
     }
+    b->count = count;
 
-    // For a full reset
-    if (full)
+    // Only the nodes that could be in range, allowing for the altitudes,
+    // are checked any further
+    reach = EDGEDIST * (1 + chordError(n->data.gps->altitude, g->highest));
+    g->totalFiltered += count - chordWithin(b, n->ecef, reach);
+    for (size_t i = 0; i < count; i++)
     {
-        if (!n->invalid)
+        if (b->marks[i])
         {
-            n->visited = false;
+            _validEdge(g, n, g->nearby[i]);
         }
-        _resetEdges(n->edges);
     }
-
-    n->weight = INITWEIGHT;
-    n->parent = NULL;
-    _resetNodes(n->next, full);
 }
 
-// Reseting the edge data
+// Freeing a stack
 static void
-_resetEdges(
-    struct _edge *e)
+_freeStack(
+    graph g,
+    struct _stack *s)
 {
-    if (!e)
+    while (s)
     {
-        return;
-    }
+        struct _stack  *freeMe = s;
 
-    e->visited = false;
-
-    _resetEdges(e->next);
-}
-
-// Freeing Edges
-static void
-_destroyEdges(
-    struct _edge *e)
-{
-    if (!e)
-    {
-        return;
+        s = s->next;
+        arenaFree(&g->stackArena, freeMe);
     }
-
-    _destroyEdges(e->next);
-    free(e);
 }
 
-// Freeing nodes and all their data
+// Freeing a node and all its data
 static void
-_destroyNodes(
+_freeNode(
+    graph g,
     struct _node *n)
 {
-    if (!n)
+    while (n->edges)
     {
-        return;
-    }
+        struct _edge   *freeMe = n->edges;
 
-    _destroyEdges(n->edges);
-    _destroyNodes(n->next);
-
-    if (n->data.status)
-    {
-        free(n->data.status);
-    }
-    if (n->data.gps)
-    {
-        free(n->data.gps);
-    }
-    if (n->invalid)
-    {
-        _freeStack(n->invalid);
+        n->edges = freeMe->next;
+        arenaFree(&g->edgeArena, freeMe);
     }
-    free(n);
+    _freeStack(g, n->invalid);
+    arenaFree(&g->statusArena, n->data.status);
+    arenaFree(&g->gpsArena, n->data.gps);
+    arenaFree(&g->nodeArena, n);
 }
@@ -5,6 +5,7 @@
 #define BOTH 2
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <stdbool.h>
 
 #include "zergHeaders.h"
@@ -27,6 +28,27 @@ int             graphAddStatus(
     union zergH zHead,
     struct statusH status);
 
+// Adding decoded records in order, up to and including the first one with a
+// duplicate id. errs, if not NULL, gets the code graphAddNode or
+// graphAddStatus would have returned for each record that was added. Returns
+// 2 if it stopped on a duplicate and 0 otherwise
+int             graphAddBatch(
+    graph g,
+    struct zergRecord *recs,
+    size_t count,
+    int *errs);
+
+// Setting whether edges are added as nodes arrive or only once
+// graphBuildEdges is called, switching back builds any that are waiting
+void            graphDeferEdges(
+    graph g,
+    bool defer);
+
+// Adding the edges for every node waiting on them, every function reading
+// edges calls this first
+void            graphBuildEdges(
+    graph g);
+
 // Analyzing the graph for bad nodes
 void            graphAnalyzeGraph(
     graph g);
@@ -40,10 +62,59 @@ void            graphPrintLowHP(
     graph g,
     int limit);
 
+// Returning if more than half the nodes would have to be removed
+bool            graphTooManyChanges(
+    graph g);
+
+// Copying up to max ids of the nodes to remove, returns how many there are
+size_t          graphBadIds(
+    graph g,
+    unsigned int *ids,
+    size_t max);
+
+// Copying up to max ids of the nodes at or below limit HP, returns how many
+// there are
+size_t          graphLowHPIds(
+    graph g,
+    int limit,
+    unsigned int *ids,
+    size_t max);
+
+// Returning if an allocation failed since the graph was created, whatever
+// was being added or analyzed then is missing from it
+bool            graphOutOfMemory(
+    graph g);
+
 // Removing incomplete nodes
 void            graphRemoveBadNodes(
     graph g);
 
+// Printing the arena allocations made for the graph
+void            graphPrintAllocs(
+    graph g,
+    FILE * fp);
+
+// Counting the objects handed out and blocks allocated by the graph's arenas
+void            graphAllocCounts(
+    graph g,
+    size_t * objects,
+    size_t * blocks);
+
+// Counting the nodes, edges and pairs too close to be edges in the graph
+void            graphCounts(
+    graph g,
+    size_t * nodes,
+    size_t * edges,
+    size_t * invalid);
+
+// Counting the pairs of grid neighbors checked, how many of them the
+// prefilter threw out and how many needed the full haversine
+void            graphPairCounts(
+    graph g,
+    size_t * pairs,
+    size_t * filtered,
+    size_t * exact);
+
 // Freeing the graph
 void            graphDestroy(
     graph g);
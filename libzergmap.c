@@ -0,0 +1,228 @@
+/*  libzergmap.c  */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "zergHeaders.h"
+#include "util.h"
+#include "graph.h"
+#include "pcapMap.h"
+#include "zergDecode.h"
+#include "zergIngest.h"
+#include "libzergmap.h"
+
+struct _zmap
+{
+    graph           g;
+    bool            analyzed;
+} _zmap;
+
+// Returning ZMAP_MEMORY if the graph ran out of memory, err otherwise
+static int      _fed(
+    zmap z,
+    int err);
+
+static const char *_errors[] = {
+    "Success",
+    "Error",
+    "Duplicate Zerg Ids",
+    "Unable to open the file",
+    "Invalid PCAP Version",
+    "Out of memory"
+};
+
+// Creating an empty zmap, NULL if it could not be allocated
+zmap
+zmapCreate(
+    void)
+{
+    zmap            z = calloc(1, sizeof(*z));
+
+    if (!z)
+    {
+        return NULL;
+    }
+
+    z->g = graphCreate();
+    if (!z->g)
+    {
+        free(z);
+        return NULL;
+    }
+    graphDeferEdges(z->g, true);
+
+    return z;
+}
+
+// Freeing a zmap and everything fed to it
+void
+zmapDestroy(
+    zmap z)
+{
+    if (!z)
+    {
+        return;
+    }
+
+    graphDestroy(z->g);
+    free(z);
+}
+
+// Mapping a pcap file and feeding every packet in it
+int
+zmapOpenCapture(
+    zmap z,
+    const char *path)
+{
+    struct span     file;
+    int             err;
+
+    if (!z || !path)
+    {
+        return ZMAP_ERROR;
+    }
+
+    if (pcapMapOpen(path, &file))
+    {
+        return ZMAP_OPEN;
+    }
+
+    err = zmapFeedCapture(z, file.data, file.length);
+
+    pcapMapClose(&file);
+
+    return err;
+}
+
+// Feeding a whole pcap file that is already in memory
+int
+zmapFeedCapture(
+    zmap z,
+    const void *data,
+    size_t length)
+{
+    struct span     cursor = { data, length };
+    int             swap = 0;
+
+    if (!z || !data)
+    {
+        return ZMAP_ERROR;
+    }
+
+    if (invalidPCAPHeaderSpan(&cursor, &swap, NULL))
+    {
+        return ZMAP_FORMAT;
+    }
+
+    return _fed(z, ingestRecords(&cursor, cursor.length, swap, ingestApply,
+                                 z->g));
+}
+
+// Feeding one captured Ethernet frame
+int
+zmapFeedPacket(
+    zmap z,
+    const void *frame,
+    size_t length)
+{
+    if (!z || !frame)
+    {
+        return ZMAP_ERROR;
+    }
+
+    return _fed(z, ingestPacket(frame, length, ingestApply, z->g));
+}
+
+// Feeding one Zerg header and payload as found in a UDP datagram
+int
+zmapFeedDatagram(
+    zmap z,
+    const void *data,
+    size_t length)
+{
+    if (!z || !data)
+    {
+        return ZMAP_ERROR;
+    }
+
+    return _fed(z, ingestDatagram(data, length, ingestApply, z->g));
+}
+
+// Dropping zerg without GPS data and finding the zerg to remove, more can
+// be fed and analyzed again afterwards
+int
+zmapAnalyze(
+    zmap z)
+{
+    if (!z)
+    {
+        return ZMAP_ERROR;
+    }
+
+    graphRemoveBadNodes(z->g);
+    graphAnalyzeGraph(z->g);
+    z->analyzed = !graphOutOfMemory(z->g);
+
+    return _fed(z, ZMAP_OK);
+}
+
+// Returning if more than half the zerg would have to be removed
+bool
+zmapTooManyChanges(
+    zmap z)
+{
+    return z && z->analyzed && graphTooManyChanges(z->g);
+}
+
+// Copying up to max ids of the zerg to remove, returns how many there are
+size_t
+zmapRemovals(
+    zmap z,
+    unsigned int *ids,
+    size_t max)
+{
+    if (!z || !z->analyzed)
+    {
+        return 0;
+    }
+
+    return graphBadIds(z->g, ids, ids ? max : 0);
+}
+
+// Copying up to max ids of the zerg at or below limit percent HP, returns
+// how many there are
+size_t
+zmapLowHP(
+    zmap z,
+    int limit,
+    unsigned int *ids,
+    size_t max)
+{
+    if (!z)
+    {
+        return 0;
+    }
+
+    return graphLowHPIds(z->g, limit, ids, ids ? max : 0);
+}
+
+// Returning ZMAP_MEMORY if the graph ran out of memory, err otherwise
+static int
+_fed(
+    zmap z,
+    int err)
+{
+    return graphOutOfMemory(z->g) ? ZMAP_MEMORY : err;
+}
+
+// Returning a message for an error code
+const char     *
+zmapStrerror(
+    int err)
+{
+    if (err < ZMAP_OK || err > ZMAP_MEMORY)
+    {
+        return "Unknown error";
+    }
+
+    return _errors[err];
+}
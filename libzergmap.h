@@ -0,0 +1,88 @@
+/*  libzergmap.h  */
+
+#ifndef LIBZERGMAP_H
+#define LIBZERGMAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Error codes returned by the library, none of its functions exit
+enum zmapErr
+{
+    ZMAP_OK = 0,
+    ZMAP_ERROR = 1,
+    ZMAP_DUPLICATE = 2,
+    ZMAP_OPEN,
+    ZMAP_FORMAT,
+    ZMAP_MEMORY
+};
+
+/*
+ * A zmap holds the graph built from everything fed to it. Packets that
+ * can't be used are skipped and counted by the diagnostics, they aren't
+ * errors, and nothing is printed. Once an allocation fails every call that
+ * feeds or analyzes returns ZMAP_MEMORY, since the zmap is missing
+ * whatever was being added. A zmap can only be used from one thread at a time, and the
+ * diagnostic counters are shared by every zmap in the process.
+ */
+typedef struct _zmap *zmap;
+
+// Creating an empty zmap, NULL if it could not be allocated
+zmap            zmapCreate(
+    void);
+
+// Freeing a zmap and everything fed to it
+void            zmapDestroy(
+    zmap z);
+
+// Mapping a pcap file and feeding every packet in it
+int             zmapOpenCapture(
+    zmap z,
+    const char *path);
+
+// Feeding a whole pcap file that is already in memory
+int             zmapFeedCapture(
+    zmap z,
+    const void *data,
+    size_t length);
+
+// Feeding one captured Ethernet frame
+int             zmapFeedPacket(
+    zmap z,
+    const void *frame,
+    size_t length);
+
+// Feeding one Zerg header and payload as found in a UDP datagram
+int             zmapFeedDatagram(
+    zmap z,
+    const void *data,
+    size_t length);
+
+// Dropping zerg without GPS data and finding the zerg to remove, more can
+// be fed and analyzed again afterwards
+int             zmapAnalyze(
+    zmap z);
+
+// Returning if more than half the zerg would have to be removed
+bool            zmapTooManyChanges(
+    zmap z);
+
+// Copying up to max ids of the zerg to remove, returns how many there are
+size_t          zmapRemovals(
+    zmap z,
+    unsigned int *ids,
+    size_t max);
+
+// Copying up to max ids of the zerg at or below limit percent HP, returns
+// how many there are
+size_t          zmapLowHP(
+    zmap z,
+    int limit,
+    unsigned int *ids,
+    size_t max);
+
+// Returning a message for an error code
+const char     *zmapStrerror(
+    int err);
+
+#endif
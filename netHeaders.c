@@ -9,8 +9,8 @@
 #include "util.h"
 #include "netHeaders.h"
 
-// Setting and writing all the headers to the pcap
-void
+// Setting and writing all the headers to the pcap, returns true on a short write
+bool
 setAllHeaders(
     int payloadLenth,
     FILE * fp,
@@ -25,58 +25,93 @@ setAllHeaders(
     setEthHeadDefault(ethHead);
     setIPHeadDefault(ipHead, 28 + payloadLenth);
     setUDPHeadDefault(udpHead, 8 + payloadLenth);
-    safeWrite(fp, packetHead, sizeof(*packetHead), msg);
-    safeWrite(fp, ethHead, sizeof(*ethHead), msg);
-    skipAhead(fp, 0, "", ETHCORRECTION);
-    safeWrite(fp, ipHead, sizeof(*ipHead), msg);
-    safeWrite(fp, udpHead, sizeof(*udpHead), msg);
+
+    return safeWrite(fp, packetHead, sizeof(*packetHead), msg) ||
+        safeWrite(fp, ethHead, sizeof(*ethHead), msg) ||
+        skipAhead(fp, DIAG_NONE, ETHCORRECTION) ||
+        safeWrite(fp, ipHead, sizeof(*ipHead), msg) ||
+        safeWrite(fp, udpHead, sizeof(*udpHead), msg);
 }
 
 // Setting the UDP headers
-void
+bool
 setUDPHead(
     FILE * fp,
     struct udpH *udpHead,
     const char *msg)
 {
-    safeRead(fp, udpHead, sizeof(*udpHead), msg);
+    if (safeRead(fp, udpHead, sizeof(*udpHead), msg))
+    {
+        return true;
+    }
     udpHead->dport = u16BitSwap(udpHead->dport);
+
+    return false;
 }
 
 // Settings IPv6 Header
-void
+bool
 setIPv6Head(
     FILE * fp,
     struct ipv6H *ipHead,
     const char *msg)
 {
-    safeRead(fp, ipHead, sizeof(*ipHead), msg);
+    if (safeRead(fp, ipHead, sizeof(*ipHead), msg))
+    {
+        return true;
+    }
     ipHead->nextHead = u8BitSwap(ipHead->nextHead);
+
+    return false;
 }
 
 // Setting IPv4 header
-void
+bool
 setIPv4Head(
     FILE * fp,
     struct ipv4H *ipHead,
     const char *msg)
 {
-    safeRead(fp, ipHead, sizeof(*ipHead), msg);
+    return safeRead(fp, ipHead, sizeof(*ipHead), msg);
 }
 
 // Setting Ethernet header
-void
+bool
 setEthHead(
     FILE * fp,
     union ethernetH *ethHead,
     const char *msg)
 {
-    safeRead(fp, ethHead, sizeof(*ethHead), msg);
-    skipAhead(fp, 0, "", ETHCORRECTION);
+    if (safeRead(fp, ethHead, sizeof(*ethHead), msg) ||
+        skipAhead(fp, DIAG_NONE, ETHCORRECTION))
+    {
+        return true;
+    }
     ethHead->ethInfo.type = u16BitSwap(ethHead->ethInfo.type);
+
+    return false;
 }
 
-// Setting the pcap header
+// Setting the Packet header from a span and swapping in nessasary
+int
+setPacketHeadSpan(
+    struct span *s,
+    struct pcapPacketH *pHead,
+    int swap)
+{
+    if (spanRead(s, pHead, sizeof(*pHead)))
+    {
+        return 0;
+    }
+    if (swap)
+    {
+        pHead->length = u32BitSwap(pHead->length);
+    }
+
+    return 1;
+}
+
+// Setting the pcap header, returns -1 if it couldn't be read
 int
 setPcapHead(
     FILE * fp,
@@ -85,7 +120,10 @@ setPcapHead(
 {
     int             swap = 0;
 
-    safeRead(fp, pHead, sizeof(*pHead), msg);
+    if (safeRead(fp, pHead, sizeof(*pHead), msg))
+    {
+        return -1;
+    }
 
     if (pHead->fileType == PCAPFILETYPE)
     {
@@ -117,7 +155,7 @@ setPacketHead(
     return err;
 }
 
-// Seting default values for the PCAP Header
+// Seting default values for the PCAP Header, swapped for a big endian file
 void
 setPcapHeadDefault(
     struct pcapFileH *pHead,
@@ -125,19 +163,23 @@ setPcapHeadDefault(
 {
     if (swap)
     {
-        pHead->fileType = u32BitSwap(PCAPFILETYPE);
+        pHead->fileType = PCAPFILETYPE;
+        pHead->majVer = u16BitSwap(PCAPHEADMAJ);
+        pHead->minVer = u16BitSwap(PCAPHEADMIN);
+        pHead->maxLength = u32BitSwap(PCAPSNAPLEN);
+        pHead->linkType = u32BitSwap(PCAPHEADLINK);
     }
     else
     {
-        pHead->fileType = PCAPFILETYPE;
+        pHead->fileType = u32BitSwap(PCAPFILETYPE);
+        pHead->majVer = PCAPHEADMAJ;
+        pHead->minVer = PCAPHEADMIN;
+        pHead->maxLength = PCAPSNAPLEN;
+        pHead->linkType = PCAPHEADLINK;
     }
 
-    pHead->majVer = 2;
-    pHead->minVer = 4;
     pHead->gmtOffset = 0;
     pHead->accDelta = 0;
-    pHead->maxLength = 0;
-    pHead->linkType = 1;
 }
 
 // Setting default values for the Packet Header
@@ -149,7 +191,7 @@ setPacketHeadDefault(
     pHead->unixEpoch = 0;
     pHead->microEpoch = 0;
     pHead->length = length;
-    pHead->untrunLength = 0;
+    pHead->untrunLength = length;
 }
 
 // Setting default values for the Ethernet Header
@@ -182,6 +224,22 @@ setIPHeadDefault(
     ipHead->dip = 0;
 }
 
+// Setting default values for the IPv6 Header
+void
+setIPv6HeadDefault(
+    struct ipv6H *ipHead,
+    unsigned int length,
+    unsigned int nextHead)
+{
+    memset(ipHead, 0, sizeof(*ipHead));
+
+    // The bitfields are in host order, so the version nibble is set by hand
+    *(unsigned char *) ipHead = IPV6 << 4;
+    ipHead->length = u16BitSwap(length);
+    ipHead->nextHead = nextHead;
+    ipHead->hop = 64;
+}
+
 // Setting default values for the UDP Header
 void
 setUDPHeadDefault(
@@ -3,10 +3,15 @@
 #ifndef NETHEADERS_H
 #define NETHEADERS_H
 
+#include <stdbool.h>
+
+struct span;
+
 #define PCAPFILETYPE 0xD4C3B2A1
 #define PCAPHEADMAJ 2
 #define PCAPHEADMIN 4
 #define PCAPHEADLINK 1
+#define PCAPSNAPLEN 65535
 
 #define ETHCORRECTION -2
 #define ETH8021CORRECTION -10
@@ -16,6 +21,7 @@
 #define ETHIPV6 0x86dd
 
 #define IPV4 0x4
+#define IPV6 0x6
 #define UDP 0x11
 #define IP6INIP4 0x29
 #define IHLDEFAULT 0x5
@@ -29,7 +35,7 @@ struct pcapFileH
     unsigned int    accDelta;
     unsigned int    maxLength;
     unsigned int    linkType;
-} pcapFileH;
+};
 
 struct pcapPacketH
 {
@@ -37,7 +43,7 @@ struct pcapPacketH
     unsigned int    microEpoch;
     unsigned int    length;
     unsigned int    untrunLength;
-} pcapPacketH;
+};
 
 
 union ethernetH
@@ -50,7 +56,7 @@ union ethernetH
     } ethInfo;
     char            raw[16];
 
-} ethernetH;
+};
 
 struct ipv4H
 {
@@ -67,7 +73,7 @@ struct ipv4H
     unsigned int    checksum:16;
     unsigned int    sip:32;
     unsigned int    dip:32;
-} ipv4;
+};
 
 struct ipv6H
 {
@@ -79,7 +85,7 @@ struct ipv6H
     unsigned int    hop:8;
     char            sip[16];
     char            dip[16];
-} ipv6H;
+};
 
 struct udpH
 {
@@ -87,7 +93,7 @@ struct udpH
     unsigned int    dport:16;
     unsigned int    length:16;
     unsigned int    checksum:16;
-} udp;
+};
 
 void            setPcapHeadDefault(
     struct pcapFileH *pHead,
@@ -100,10 +106,16 @@ void            setEthHeadDefault(
 void            setIPHeadDefault(
     struct ipv4H *ipHead,
     unsigned int length);
+void            setIPv6HeadDefault(
+    struct ipv6H *ipHead,
+    unsigned int length,
+    unsigned int nextHead);
 void            setUDPHeadDefault(
     struct udpH *udpHead,
     unsigned int length);
 
+// Each reader below returns true if the read came up short, setPcapHead
+// returns -1 instead of whether the file is swapped
 int             setPcapHead(
     FILE * fp,
     struct pcapFileH *pHead,
@@ -112,24 +124,29 @@ int             setPacketHead(
     FILE * fp,
     struct pcapPacketH *pHead,
     int swap);
-void            setEthHead(
+bool            setEthHead(
     FILE * fp,
     union ethernetH *ethHead,
     const char *msg);
-void            setIPv4Head(
+bool            setIPv4Head(
     FILE * fp,
     struct ipv4H *ipHead,
     const char *msg);
-void            setIPv6Head(
+bool            setIPv6Head(
     FILE * fp,
     struct ipv6H *ipHead,
     const char *msg);
-void            setUDPHead(
+bool            setUDPHead(
     FILE * fp,
     struct udpH *udpHead,
     const char *msg);
 
-void            setAllHeaders(
+int             setPacketHeadSpan(
+    struct span *s,
+    struct pcapPacketH *pHead,
+    int swap);
+
+bool            setAllHeaders(
     int payloadLenth,
     FILE * fp,
     struct pcapPacketH *packetHead,
@@ -0,0 +1,77 @@
+/*  pcapMap.c  */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "zergHeaders.h"
+#include "util.h"
+#include "pcapMap.h"
+
+// Mapping a whole file into memory, returns true if it could not be mapped
+bool
+pcapMapOpen(
+    const char *path,
+    struct span *file)
+{
+    struct stat     info;
+    int             fd = open(path, O_RDONLY);
+
+    file->data = NULL;
+    file->length = 0;
+
+    if (fd < 0)
+    {
+        return true;
+    }
+
+    if (fstat(fd, &info) || !S_ISREG(info.st_mode))
+    {
+        close(fd);
+        return true;
+    }
+
+    // Empty files have nothing to map, the header check will reject them
+    if (info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void           *base =
+        mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // The mapping holds its own reference to the file
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        return true;
+    }
+
+    // Records are only ever walked front to back
+    posix_madvise(base, info.st_size, POSIX_MADV_SEQUENTIAL);
+
+    file->data = base;
+    file->length = info.st_size;
+
+    return false;
+}
+
+// Unmapping a file that was mapped with pcapMapOpen
+void
+pcapMapClose(
+    struct span *file)
+{
+    if (!file || !file->data)
+    {
+        return;
+    }
+
+    munmap((void *) file->data, file->length);
+    file->data = NULL;
+    file->length = 0;
+}
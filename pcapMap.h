@@ -0,0 +1,19 @@
+/*  pcapMap.h  */
+
+#ifndef PCAPMAP_H
+#define PCAPMAP_H
+
+#include <stdbool.h>
+
+struct span;
+
+// Mapping a whole file into memory, returns true if it could not be mapped
+bool            pcapMapOpen(
+    const char *path,
+    struct span *file);
+
+// Unmapping a file that was mapped with pcapMapOpen
+void            pcapMapClose(
+    struct span *file);
+
+#endif
@@ -0,0 +1,227 @@
+/*  pcapStream.c  */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "zergHeaders.h"
+#include "netHeaders.h"
+#include "zergDecode.h"
+#include "util.h"
+#include "zergStats.h"
+#include "zergDiag.h"
+#include "pcapStream.h"
+
+// Setting up a stream over fd, returns true if the buffer couldn't be made
+bool
+streamOpen(
+    struct pcapStream *s,
+    int fd)
+{
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->buf = malloc(STREAMBUFFER);
+    s->size = STREAMBUFFER;
+
+    return !s->buf;
+}
+
+// Freeing the buffer, the descriptor is left to the caller
+void
+streamClose(
+    struct pcapStream *s)
+{
+    free(s->buf);
+    s->buf = NULL;
+    s->size = 0;
+}
+
+// Dropping everything buffered so the file is read again from its header
+void
+streamReset(
+    struct pcapStream *s)
+{
+    s->start = 0;
+    s->end = 0;
+    s->need = 0;
+    s->discard = 0;
+    s->offset = 0;
+    s->swap = 0;
+    s->started = false;
+}
+
+// Reading the rest of the stream from source instead of the descriptor,
+// whatever was buffered is dropped
+void
+streamFrom(
+    struct pcapStream *s,
+    streamSource source,
+    void *ctx)
+{
+    streamReset(s);
+    s->source = source;
+    s->ctx = ctx;
+}
+
+/*
+ * Bytes are read in whatever amounts the descriptor has ready. Whatever is
+ * left of a partial record is moved to the front of the buffer before the
+ * next read, and the buffer only grows when one record needs more room than
+ * it has. Nothing is ever sought, so pipes and growing files both work.
+ */
+
+// Reading whatever is waiting, returns -1 on a read error, 0 at the end of
+// the file and otherwise how many bytes were read
+ssize_t
+streamFill(
+    struct pcapStream *s)
+{
+    ssize_t         got;
+    size_t          want = s->need > STREAMBUFFER ? s->need : STREAMBUFFER;
+
+    // Moving the partial record left over to the front
+    if (s->start)
+    {
+        memmove(s->buf, s->buf + s->start, s->end - s->start);
+        s->end -= s->start;
+        s->start = 0;
+    }
+
+    // Growing to hold a record bigger than the buffer
+    if (want > s->size)
+    {
+        unsigned char  *grown = realloc(s->buf, want);
+
+        if (!grown)
+        {
+            return -1;
+        }
+        s->buf = grown;
+        s->size = want;
+    }
+
+    do
+    {
+        got = s->source ? s->source(s->ctx, s->buf + s->end, s->size - s->end)
+            : read(s->fd, s->buf + s->end, s->size - s->end);
+    } while (got < 0 && errno == EINTR);
+
+    if (got <= 0)
+    {
+        return got;
+    }
+    s->end += got;
+    s->offset += got;
+
+    // Dropping the rest of a record too big to ever hold
+    if (s->discard)
+    {
+        size_t          drop = s->end - s->start;
+
+        drop = drop < s->discard ? drop : s->discard;
+        s->start += drop;
+        s->discard -= drop;
+    }
+
+    return got;
+}
+
+// Cutting the next whole record out of the buffer, returns 1 with packet
+// set, 0 if more bytes are needed and -1 if the file header is invalid
+int
+streamNext(
+    struct pcapStream *s,
+    struct span *packet)
+{
+    struct span     rest = { s->buf + s->start, s->end - s->start };
+    struct pcapPacketH ppHeader;
+
+    if (s->discard)
+    {
+        return 0;
+    }
+
+    // The file header can arrive in pieces as well
+    if (!s->started)
+    {
+        if (rest.length < sizeof(struct pcapFileH))
+        {
+            s->need = sizeof(struct pcapFileH);
+            return 0;
+        }
+        if (invalidPCAPHeaderSpan(&rest, &s->swap, stderr))
+        {
+            return -1;
+        }
+        s->start += sizeof(struct pcapFileH);
+        s->started = true;
+        statsRead(0, sizeof(struct pcapFileH));
+    }
+
+    if (!setPacketHeadSpan(&rest, &ppHeader, s->swap))
+    {
+        s->need = sizeof(ppHeader);
+        return 0;
+    }
+
+    // A record longer than any capture is skipped as it goes by
+    if (ppHeader.length > STREAMRECORD - sizeof(ppHeader))
+    {
+        size_t          drop = rest.length;
+
+        statsRead(1, sizeof(ppHeader) + ppHeader.length);
+        diagReport(DIAG_PACKETHEAD);
+        s->start += sizeof(ppHeader) + drop;
+        s->discard = ppHeader.length - drop;
+        s->need = 0;
+        return 0;
+    }
+
+    if (rest.length < ppHeader.length)
+    {
+        s->need = sizeof(ppHeader) + ppHeader.length;
+        return 0;
+    }
+
+    statsRead(1, sizeof(ppHeader) + ppHeader.length);
+    packet->data = rest.data;
+    packet->length = ppHeader.length;
+    s->start += sizeof(ppHeader) + ppHeader.length;
+    s->need = 0;
+
+    return 1;
+}
+
+// Cutting out what was read of a record the file ended partway through,
+// returns 1 with packet set, 0 if nothing is left and -1 if the file ended
+// before its header
+int
+streamLast(
+    struct pcapStream *s,
+    struct span *packet)
+{
+    struct span     rest = { s->buf + s->start, s->end - s->start };
+    struct pcapPacketH ppHeader;
+
+    if (!s->started)
+    {
+        fprintf(stderr, "READ ERROR AT: %s\n", "Packet is corrupted or empty");
+        return -1;
+    }
+
+    // Decoded as far as it goes, the same as a mapped file
+    if (s->discard || !setPacketHeadSpan(&rest, &ppHeader, s->swap))
+    {
+        return 0;
+    }
+
+    statsRead(1, sizeof(ppHeader) + ppHeader.length);
+    packet->data = rest.data;
+    packet->length = rest.length;
+    s->start = s->end;
+
+    return 1;
+}
@@ -0,0 +1,76 @@
+/*  pcapStream.h  */
+
+#ifndef PCAPSTREAM_H
+#define PCAPSTREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define STREAMBUFFER (1 << 16)
+#define STREAMRECORD (1 << 24)
+
+struct span;
+
+// Reading bytes for a stream from somewhere other than its descriptor,
+// returns like read
+typedef ssize_t (*streamSource) (void *ctx, void *buf, size_t length);
+
+// A forward only pcap reader over a descriptor, records are only handed out
+// once every byte of them has been read
+struct pcapStream
+{
+    int             fd;
+    streamSource    source;
+    void           *ctx;
+    unsigned char  *buf;
+    size_t          size;
+    size_t          start;
+    size_t          end;
+    size_t          need;
+    size_t          discard;
+    size_t          offset;
+    int             swap;
+    bool            started;
+};
+
+// Setting up a stream over fd, returns true if the buffer couldn't be made
+bool            streamOpen(
+    struct pcapStream *s,
+    int fd);
+
+// Freeing the buffer, the descriptor is left to the caller
+void            streamClose(
+    struct pcapStream *s);
+
+// Dropping everything buffered so the file is read again from its header
+void            streamReset(
+    struct pcapStream *s);
+
+// Reading the rest of the stream from source instead of the descriptor,
+// whatever was buffered is dropped
+void            streamFrom(
+    struct pcapStream *s,
+    streamSource source,
+    void *ctx);
+
+// Reading whatever is waiting, returns -1 on a read error, 0 at the end of
+// the file and otherwise how many bytes were read
+ssize_t         streamFill(
+    struct pcapStream *s);
+
+// Cutting the next whole record out of the buffer, returns 1 with packet
+// set, 0 if more bytes are needed and -1 if the file header is invalid.
+// The packet is only valid until the next streamFill
+int             streamNext(
+    struct pcapStream *s,
+    struct span *packet);
+
+// Cutting out what was read of a record the file ended partway through,
+// returns 1 with packet set, 0 if nothing is left and -1 if the file ended
+// before its header
+int             streamLast(
+    struct pcapStream *s,
+    struct span *packet);
+
+#endif
@@ -0,0 +1,491 @@
+/*  pcapUnpack.c  */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#ifdef ZSTD
+#include <zstd.h>
+#endif
+
+#include "pcapStream.h"
+#include "pcapUnpack.h"
+
+// One buffer of decompressed bytes in the ring
+struct _unpackSlot
+{
+    unsigned char  *data;
+    size_t          length;
+} _unpackSlot;
+
+// A decompression thread and the ring of buffers it fills
+struct unpacker
+{
+    int             fd;
+    enum unpackFormat format;
+    unsigned char  *in;
+    size_t          inLength;
+    struct _unpackSlot ring[UNPACKRING];
+    size_t          head;
+    size_t          tail;
+    size_t          used;
+    size_t          offset;
+    bool            done;
+    bool            failed;
+    bool            stop;
+    pthread_t       thread;
+    pthread_mutex_t lock;
+    pthread_cond_t  filled;
+    pthread_cond_t  emptied;
+} unpacker;
+
+// Decompressing until the input ends or the reader stops
+static void    *_unpackThread(
+    void *arg);
+
+// Inflating gzip members into the ring, returns true if the data is corrupt
+static bool     _gunzip(
+    struct unpacker *u);
+
+#ifdef ZSTD
+// Decompressing zstd frames into the ring, returns true if the data is
+// corrupt
+static bool     _unzstd(
+    struct unpacker *u);
+#endif
+
+// Reading more compressed input, returns like read
+static ssize_t  _readIn(
+    struct unpacker *u);
+
+// Waiting for an empty slot, returns NULL once the reader has stopped
+static struct _unpackSlot *_slotTake(
+    struct unpacker *u);
+
+// Handing a filled slot to the reader
+static void     _slotPut(
+    struct unpacker *u,
+    size_t length);
+
+// Freeing the ring and the input buffer
+static void     _unpackFree(
+    struct unpacker *u);
+
+// Returning the compression the first bytes of a file were written with
+enum unpackFormat
+unpackDetect(
+    const unsigned char *data,
+    size_t length)
+{
+    static const unsigned char gzip[] = { 0x1f, 0x8b };
+    static const unsigned char zstd[] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+    if (length >= sizeof(gzip) && !memcmp(data, gzip, sizeof(gzip)))
+    {
+        return UNPACK_GZIP;
+    }
+    if (length >= sizeof(zstd) && !memcmp(data, zstd, sizeof(zstd)))
+    {
+        return UNPACK_ZSTD;
+    }
+
+    return UNPACK_NONE;
+}
+
+/*
+ * The thread owns the input and fills whole slots of the ring, so the reader
+ * only ever waits when it has caught up with every slot that was filled.
+ * Each slot is handed back once the reader has copied all of it out.
+ */
+
+// Starting a thread that decompresses fd into a ring of buffers, head holds
+// whatever was already read from fd. Returns NULL if it couldn't be started
+struct unpacker *
+unpackStart(
+    int fd,
+    enum unpackFormat format,
+    const unsigned char *head,
+    size_t length)
+{
+    struct unpacker *u;
+    bool            missing = false;
+
+#ifndef ZSTD
+    if (format == UNPACK_ZSTD)
+    {
+        fprintf(stderr, "Built without zstd support\n");
+        return NULL;
+    }
+#endif
+
+    if (length > UNPACKCHUNK)
+    {
+        return NULL;
+    }
+    if (!(u = calloc(1, sizeof(*u))))
+    {
+        fprintf(stderr, "Out of memory\n");
+        return NULL;
+    }
+    pthread_mutex_init(&u->lock, NULL);
+    pthread_cond_init(&u->filled, NULL);
+    pthread_cond_init(&u->emptied, NULL);
+
+    u->fd = fd;
+    u->format = format;
+    u->in = malloc(UNPACKCHUNK);
+    missing = !u->in;
+    for (int i = 0; i < UNPACKRING; i++)
+    {
+        u->ring[i].data = malloc(UNPACKCHUNK);
+        missing = missing || !u->ring[i].data;
+    }
+    if (missing)
+    {
+        fprintf(stderr, "Out of memory\n");
+        _unpackFree(u);
+        return NULL;
+    }
+
+    memcpy(u->in, head, length);
+    u->inLength = length;
+
+    if (pthread_create(&u->thread, NULL, _unpackThread, u))
+    {
+        fprintf(stderr, "Unable to start decompressing\n");
+        _unpackFree(u);
+        return NULL;
+    }
+
+    return u;
+}
+
+// Reading the first bytes of a stream and, if they are compressed, reading
+// the rest of it through an unpacker. Returns true if one couldn't be started
+bool
+unpackStream(
+    struct pcapStream *s,
+    struct unpacker **u)
+{
+    enum unpackFormat format;
+
+    *u = NULL;
+    while (s->end - s->start < UNPACKMAGIC && streamFill(s) > 0)
+    {
+        continue;
+    }
+
+    format = unpackDetect(s->buf + s->start, s->end - s->start);
+    if (format == UNPACK_NONE)
+    {
+        return false;
+    }
+    if (!(*u = unpackStart(s->fd, format, s->buf + s->start,
+                           s->end - s->start)))
+    {
+        return true;
+    }
+    streamFrom(s, unpackRead, *u);
+
+    return false;
+}
+
+// Copying out up to length decompressed bytes, waiting only when the ring
+// is empty. Returns -1 if the data is corrupt, 0 at the end and otherwise
+// how many bytes were copied
+ssize_t
+unpackRead(
+    void *ctx,
+    void *buf,
+    size_t length)
+{
+    struct unpacker *u = ctx;
+    struct _unpackSlot *slot;
+    size_t          copy;
+
+    pthread_mutex_lock(&u->lock);
+    for (;;)
+    {
+        // Handing back a slot that has been copied out
+        if (u->used && u->offset == u->ring[u->tail].length)
+        {
+            u->tail = (u->tail + 1) % UNPACKRING;
+            u->used--;
+            u->offset = 0;
+            pthread_cond_signal(&u->emptied);
+            continue;
+        }
+        if (u->used || u->done)
+        {
+            break;
+        }
+        pthread_cond_wait(&u->filled, &u->lock);
+    }
+
+    if (!u->used)
+    {
+        pthread_mutex_unlock(&u->lock);
+        return u->failed ? -1 : 0;
+    }
+    slot = &u->ring[u->tail];
+    pthread_mutex_unlock(&u->lock);
+
+    // The thread leaves a slot alone until it is handed back
+    copy = slot->length - u->offset;
+    copy = copy < length ? copy : length;
+    memcpy(buf, slot->data + u->offset, copy);
+    u->offset += copy;
+
+    return copy;
+}
+
+// Stopping the thread and freeing the ring, fd is left to the caller
+void
+unpackStop(
+    struct unpacker *u)
+{
+    if (!u)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&u->lock);
+    u->stop = true;
+    pthread_cond_broadcast(&u->emptied);
+    pthread_mutex_unlock(&u->lock);
+
+    pthread_join(u->thread, NULL);
+    _unpackFree(u);
+}
+
+// Decompressing until the input ends or the reader stops
+static void    *
+_unpackThread(
+    void *arg)
+{
+    struct unpacker *u = arg;
+    bool            failed = true;
+
+    if (u->format == UNPACK_GZIP)
+    {
+        failed = _gunzip(u);
+    }
+#ifdef ZSTD
+    else
+    {
+        failed = _unzstd(u);
+    }
+#endif
+
+    pthread_mutex_lock(&u->lock);
+    u->done = true;
+    u->failed = failed;
+    pthread_cond_broadcast(&u->filled);
+    pthread_mutex_unlock(&u->lock);
+
+    return NULL;
+}
+
+// Inflating gzip members into the ring, returns true if the data is corrupt
+static bool
+_gunzip(
+    struct unpacker *u)
+{
+    z_stream        zs = { 0 };
+    struct _unpackSlot *slot;
+    ssize_t         got = 0;
+    bool            eof = false;
+    bool            corrupt = false;
+    int             ret = Z_OK;
+
+    // Only gzip wrapped data is accepted
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK)
+    {
+        return true;
+    }
+    zs.next_in = u->in;
+    zs.avail_in = u->inLength;
+
+    while (!corrupt && (slot = _slotTake(u)))
+    {
+        zs.next_out = slot->data;
+        zs.avail_out = UNPACKCHUNK;
+
+        while (zs.avail_out && !corrupt)
+        {
+            unsigned int    before = zs.avail_out;
+
+            if (!zs.avail_in && !eof)
+            {
+                got = _readIn(u);
+                eof = got <= 0;
+                zs.next_in = u->in;
+                zs.avail_in = got > 0 ? got : 0;
+            }
+
+            // Captures written as several members carry on into the next
+            if (ret == Z_STREAM_END)
+            {
+                if (!zs.avail_in)
+                {
+                    break;
+                }
+                inflateReset(&zs);
+            }
+
+            ret = inflate(&zs, Z_NO_FLUSH);
+            corrupt = ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR;
+            if (eof && zs.avail_out == before)
+            {
+                break;
+            }
+        }
+
+        _slotPut(u, UNPACKCHUNK - zs.avail_out);
+        if (zs.avail_out)
+        {
+            break;
+        }
+    }
+
+    inflateEnd(&zs);
+
+    return corrupt || got < 0 || (eof && ret != Z_STREAM_END);
+}
+
+#ifdef ZSTD
+// Decompressing zstd frames into the ring, returns true if the data is
+// corrupt
+static bool
+_unzstd(
+    struct unpacker *u)
+{
+    ZSTD_DStream   *zs = ZSTD_createDStream();
+    ZSTD_inBuffer   in = { u->in, u->inLength, 0 };
+    ZSTD_outBuffer  out;
+    struct _unpackSlot *slot;
+    ssize_t         got = 0;
+    bool            eof = false;
+    bool            corrupt = !zs;
+    size_t          ret = 1;
+
+    if (zs)
+    {
+        ZSTD_initDStream(zs);
+    }
+
+    // Frames that follow one another are decoded without a reset
+    while (!corrupt && (slot = _slotTake(u)))
+    {
+        out.dst = slot->data;
+        out.size = UNPACKCHUNK;
+        out.pos = 0;
+
+        while (out.pos < out.size && !corrupt)
+        {
+            size_t          before = out.pos;
+
+            if (in.pos == in.size && !eof)
+            {
+                got = _readIn(u);
+                eof = got <= 0;
+                in.size = got > 0 ? got : 0;
+                in.pos = 0;
+            }
+
+            // Past the last frame zstd asks for another one's header
+            if (eof && in.pos == in.size && ret == 0)
+            {
+                break;
+            }
+
+            ret = ZSTD_decompressStream(zs, &out, &in);
+            corrupt = ZSTD_isError(ret);
+            if (eof && out.pos == before && in.pos == in.size)
+            {
+                break;
+            }
+        }
+
+        _slotPut(u, out.pos);
+        if (out.pos < out.size)
+        {
+            break;
+        }
+    }
+
+    ZSTD_freeDStream(zs);
+
+    return corrupt || got < 0 || (eof && ret != 0);
+}
+#endif
+
+// Reading more compressed input, returns like read
+static ssize_t
+_readIn(
+    struct unpacker *u)
+{
+    ssize_t         got;
+
+    do
+    {
+        got = read(u->fd, u->in, UNPACKCHUNK);
+    } while (got < 0 && errno == EINTR);
+
+    return got;
+}
+
+// Waiting for an empty slot, returns NULL once the reader has stopped
+static struct _unpackSlot *
+_slotTake(
+    struct unpacker *u)
+{
+    struct _unpackSlot *slot = NULL;
+
+    pthread_mutex_lock(&u->lock);
+    while (u->used == UNPACKRING && !u->stop)
+    {
+        pthread_cond_wait(&u->emptied, &u->lock);
+    }
+    if (!u->stop)
+    {
+        slot = &u->ring[u->head];
+    }
+    pthread_mutex_unlock(&u->lock);
+
+    return slot;
+}
+
+// Handing a filled slot to the reader
+static void
+_slotPut(
+    struct unpacker *u,
+    size_t length)
+{
+    pthread_mutex_lock(&u->lock);
+    u->ring[u->head].length = length;
+    u->head = (u->head + 1) % UNPACKRING;
+    u->used++;
+    pthread_cond_signal(&u->filled);
+    pthread_mutex_unlock(&u->lock);
+}
+
+// Freeing the ring and the input buffer
+static void
+_unpackFree(
+    struct unpacker *u)
+{
+    for (int i = 0; i < UNPACKRING; i++)
+    {
+        free(u->ring[i].data);
+    }
+    free(u->in);
+    pthread_cond_destroy(&u->emptied);
+    pthread_cond_destroy(&u->filled);
+    pthread_mutex_destroy(&u->lock);
+    free(u);
+}
@@ -0,0 +1,56 @@
+/*  pcapUnpack.h  */
+
+#ifndef PCAPUNPACK_H
+#define PCAPUNPACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define UNPACKMAGIC 4
+#define UNPACKRING 8
+#define UNPACKCHUNK (1 << 18)
+
+// Compression a capture can be stored with
+enum unpackFormat
+{
+    UNPACK_NONE = 0,
+    UNPACK_GZIP,
+    UNPACK_ZSTD
+};
+
+struct unpacker;
+struct pcapStream;
+
+// Returning the compression the first bytes of a file were written with
+enum unpackFormat unpackDetect(
+    const unsigned char *data,
+    size_t length);
+
+// Starting a thread that decompresses fd into a ring of buffers, head holds
+// whatever was already read from fd. Returns NULL if it couldn't be started
+struct unpacker *unpackStart(
+    int fd,
+    enum unpackFormat format,
+    const unsigned char *head,
+    size_t length);
+
+// Reading the first bytes of a stream and, if they are compressed, reading
+// the rest of it through an unpacker. Returns true if one couldn't be started
+bool            unpackStream(
+    struct pcapStream *s,
+    struct unpacker **u);
+
+// Copying out up to length decompressed bytes, waiting only when the ring
+// is empty. Returns -1 if the data is corrupt, 0 at the end and otherwise
+// how many bytes were copied
+ssize_t         unpackRead(
+    void *ctx,
+    void *buf,
+    size_t length);
+
+// Stopping the thread and freeing the ring, fd is left to the caller
+void            unpackStop(
+    struct unpacker *u);
+
+#endif
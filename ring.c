@@ -0,0 +1,82 @@
+/*  ring.c  */
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "ring.h"
+
+/*
+ * head only ever moves on the producer thread and tail only on the consumer
+ * thread. Each side reads the other's index with acquire and publishes its
+ * own with release, so a slot is written before it is seen as filled and
+ * read before it is seen as free.
+ */
+
+// Setting up a ring that holds at least size items, returns true if it
+// couldn't be allocated
+bool
+ringInit(
+    struct ring *r,
+    size_t size)
+{
+    size_t          slots = 1;
+
+    while (slots < size)
+    {
+        slots <<= 1;
+    }
+
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->mask = slots - 1;
+    r->slots = calloc(slots, sizeof(*r->slots));
+
+    return !r->slots;
+}
+
+// Freeing the slots of a ring
+void
+ringFree(
+    struct ring *r)
+{
+    free(r->slots);
+    r->slots = NULL;
+}
+
+// Adding an item from the producer thread, returns true if the ring is full
+bool
+ringPush(
+    struct ring *r,
+    void *item)
+{
+    size_t          head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+    if (head - atomic_load_explicit(&r->tail, memory_order_acquire) > r->mask)
+    {
+        return true;
+    }
+
+    r->slots[head & r->mask] = item;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+
+    return false;
+}
+
+// Taking an item from the consumer thread, returns NULL if the ring is empty
+void           *
+ringPop(
+    struct ring *r)
+{
+    size_t          tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    void           *item;
+
+    if (tail == atomic_load_explicit(&r->head, memory_order_acquire))
+    {
+        return NULL;
+    }
+
+    item = r->slots[tail & r->mask];
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+
+    return item;
+}
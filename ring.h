@@ -0,0 +1,41 @@
+/*  ring.h  */
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define RINGLINE 64
+
+// A lock free queue of pointers between exactly one producer and one
+// consumer thread, the two indexes are kept on their own cache lines
+struct ring
+{
+    _Alignas(RINGLINE) atomic_size_t head;
+    _Alignas(RINGLINE) atomic_size_t tail;
+    _Alignas(RINGLINE) size_t mask;
+    void          **slots;
+};
+
+// Setting up a ring that holds at least size items, returns true if it
+// couldn't be allocated
+bool            ringInit(
+    struct ring *r,
+    size_t size);
+
+// Freeing the slots of a ring
+void            ringFree(
+    struct ring *r);
+
+// Adding an item from the producer thread, returns true if the ring is full
+bool            ringPush(
+    struct ring *r,
+    void *item);
+
+// Taking an item from the consumer thread, returns NULL if the ring is empty
+void           *ringPop(
+    struct ring *r);
+
+#endif
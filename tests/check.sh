@@ -0,0 +1,91 @@
+#!/bin/sh
+# Reading every case in cases with each reader zergmap has and comparing
+# what it prints, the --stats counters and the exit status against
+# expected/. Run with UPDATE=1 to write expected/ from the stdio reader
+# instead. The zstd mode is left out of the default MODES, it needs a
+# zergmap built with ZSTD=1.
+
+cd "$(dirname "$0")" || exit 1
+
+ZERGMAP=${ZERGMAP:-../zergmap}
+MODES=${MODES:-"stdio map threads pipeline stdin gzip"}
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT INT TERM
+failed=0
+ran=0
+
+# Running zergmap on a case the way mode reads it, everything it printed
+# goes to $tmp/out
+run() {
+    mode=$1
+    shift
+
+    case $mode in
+    stdio) set -- "$@" ;;
+    map) set -- -m "$@" ;;
+    threads) set -- -j 4 "$@" ;;
+    pipeline) set -- --pipeline "$@" ;;
+    stdin) first=$1; shift; set -- - "$@" ;;
+    gzip)
+        for f; do
+            shift
+            gzip -c "$f" > "$tmp/${f##*/}.gz" || return 1
+            set -- "$@" "$tmp/${f##*/}.gz"
+        done
+        ;;
+    zstd)
+        for f; do
+            shift
+            zstd -q -c "$f" > "$tmp/${f##*/}.zst" || return 1
+            set -- "$@" "$tmp/${f##*/}.zst"
+        done
+        ;;
+    esac
+
+    if [ "$mode" = stdin ]; then
+        "$ZERGMAP" --stats "$@" < "$first" > "$tmp/stdout" 2> "$tmp/stderr"
+    else
+        "$ZERGMAP" --stats "$@" > "$tmp/stdout" 2> "$tmp/stderr"
+    fi
+    status=$?
+
+    # Timings change every run, the counters never should
+    {
+        cat "$tmp/stdout"
+        echo "-- stderr"
+        grep -v '^time ' "$tmp/stderr"
+        echo "-- exit $status"
+    } > "$tmp/out"
+}
+
+while read -r name files; do
+    case $name in
+    '' | '#'*) continue ;;
+    esac
+
+    set --
+    for f in $files; do
+        set -- "$@" "captures/$f"
+    done
+
+    if [ "${UPDATE:-}" ]; then
+        run stdio "$@" && cp "$tmp/out" "expected/$name.out"
+        continue
+    fi
+
+    for mode in $MODES; do
+        ran=$((ran + 1))
+        if ! run "$mode" "$@" || ! cmp -s "$tmp/out" "expected/$name.out"; then
+            echo "FAIL $name ($mode)"
+            diff "expected/$name.out" "$tmp/out" | head -20
+            failed=$((failed + 1))
+        fi
+    done
+done < cases
+
+if [ "${UPDATE:-}" ]; then
+    exit 0
+fi
+
+echo "$((ran - failed)) of $ran passed"
+[ "$failed" -eq 0 ]
@@ -0,0 +1,49 @@
+#!/bin/bash
+# Sending the --listen daemon out of bounds GPS from one zerg, over and over,
+# then a status from the same zerg, and checking it was only counted once.
+# bash is needed to write datagrams to /dev/udp.
+
+cd "$(dirname "$0")" || exit 1
+
+ZERGMAP=${ZERGMAP:-../zergmap}
+PORT=${PORT:-$((40000 + $$ % 20000))}
+SENDS=${SENDS:-70000}
+tmp=$(mktemp -d) || exit 1
+pid=
+
+trap '[ "$pid" ] && kill "$pid" 2> /dev/null; rm -rf "$tmp"' EXIT
+
+# Zerg #7 at latitude 500, then at 9 of 100 HP. printf writes each datagram
+# in one piece as long as there is no newline in it
+gps='\x13\x00\x00\x2c\x00\x07\x00\x00\x00\x00\x00\x01'
+gps+='\x00\x00\x00\x00\x00\x00\x00\x00\x40\x7f\x40\x00\x00\x00\x00\x00'
+gps+='\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00'
+status='\x11\x00\x00\x18\x00\x07\x00\x00\x00\x00\x00\x02'
+status+='\x00\x00\x09\x00\x00\x00\x64\x00\x00\x00\x00\x00'
+
+"$ZERGMAP" --listen="$PORT" --interval=3600 > "$tmp/out" 2> "$tmp/err" &
+pid=$!
+sleep 0.5
+
+exec 3> "/dev/udp/127.0.0.1/$PORT" || exit 1
+for ((i = 0; i < SENDS; i++)); do
+    printf "$gps" >&3
+done
+sleep 0.5
+printf "$status" >&3
+exec 3>&-
+sleep 0.5
+
+kill -TERM "$pid"
+wait "$pid"
+status=$?
+pid=
+
+if [ "$status" -ne 0 ] || ! grep -q 'Out of bounds payload' "$tmp/err" ||
+    ! grep -qx 'ANALYSIS 1 (1 ZERG, 1 UPDATES)' "$tmp/out"; then
+    echo "FAIL daemon (exit $status)"
+    cat "$tmp/out" "$tmp/err"
+    exit 1
+fi
+
+echo "daemon passed"
@@ -110,8 +110,8 @@ setGPSDMS(
         round(3600 * (*direction - dms->degrees) - 60 * dms->minutes);
 }
 
-// Writing to a file
-void
+// Writing to a file, returns true if the write came up short
+bool
 safeWrite(
     FILE * fp,
     void *writeIt,
@@ -121,13 +121,14 @@ safeWrite(
     if (fwrite(writeIt, sz, 1, fp) == 0)
     {
         fprintf(stderr, "READ ERROR AT: %s\n", msg);
-        fclose(fp);
-        exit(1);
+        return true;
     }
+
+    return false;
 }
 
-// Reading from a file
-void
+// Reading from a file, returns true if the read came up short
+bool
 safeRead(
     FILE * fp,
     void *readIt,
@@ -137,30 +138,68 @@ safeRead(
     if (fread(readIt, sz, 1, fp) == 0)
     {
         fprintf(stderr, "READ ERROR AT: %s\n", msg);
-        fclose(fp);
-        exit(1);
+        return true;
     }
+
+    return false;
 }
 
-// Skipping ahead in a file
-void
+// Reading from a span, returns true if the span is too short
+bool
+spanRead(
+    struct span *s,
+    void *readIt,
+    size_t sz)
+{
+    if (s->length < sz)
+    {
+        return true;
+    }
+
+    memcpy(readIt, s->data, sz);
+    s->data += sz;
+    s->length -= sz;
+
+    return false;
+}
+
+// Skipping ahead in a span, returns true if the span is too short
+bool
+spanSkip(
+    struct span *s,
+    size_t sz)
+{
+    if (s->length < sz)
+    {
+        return true;
+    }
+
+    s->data += sz;
+    s->length -= sz;
+
+    return false;
+}
+
+// Skipping ahead in a file, counting the reason unless it is DIAG_NONE,
+// returns true if the seek failed
+bool
 skipAhead(
     FILE * fp,
-    int err,
-    const char *msg,
+    enum diagReason reason,
     int skip)
 {
-    if (err)
+    if (reason != DIAG_NONE)
     {
-        fprintf(stderr, "Skipping Packet: %s\n", msg);
+        diagReport(reason);
     }
 
     if (fseek(fp, skip, SEEK_CUR))
     {
         fprintf(stderr, "Read Error Occurred\n");
-        fclose(fp);
-        exit(1);
+        return true;
     }
+
+    return false;
 }
 
 // Swapping of 8 bit unsigned numbers
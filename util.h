@@ -4,26 +4,47 @@
 #define UTIL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
-// Reading from a file
-void            safeRead(
+#include "zergDiag.h"
+
+// A window of bytes being read from memory
+struct span
+{
+    const unsigned char *data;
+    size_t          length;
+};
+
+// Reading from a file, returns true if the read came up short
+bool            safeRead(
     FILE * fp,
     void *readIt,
     size_t sz,
     const char *msg);
 
-// Writing to a file
-void            safeWrite(
+// Writing to a file, returns true if the write came up short
+bool            safeWrite(
     FILE * fp,
     void *writeIt,
     size_t sz,
     const char *msg);
 
-// Skipping ahead in a file
-void            skipAhead(
+// Reading from a span, returns true if the span is too short
+bool            spanRead(
+    struct span *s,
+    void *readIt,
+    size_t sz);
+
+// Skipping ahead in a span, returns true if the span is too short
+bool            spanSkip(
+    struct span *s,
+    size_t sz);
+
+// Skipping ahead in a file, counting the reason unless it is DIAG_NONE,
+// returns true if the seek failed
+bool            skipAhead(
     FILE * fp,
-    int err,
-    const char *msg,
+    enum diagReason reason,
     int skip);
 
 // Swapping of 64 bit numbers
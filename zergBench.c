@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "zergHeaders.h"
+#include "graph.h"
+#include "zergIngest.h"
+#include "zergSynth.h"
+
+#define BENCHSEED 42
+
+// The decoded records of a capture, kept to build the graph from
+struct _benchRecords
+{
+    struct zergRecord *records;
+    size_t          count;
+    size_t          capacity;
+} _benchRecords;
+
+// Returning the monotonic clock in seconds
+static double   _now(
+    void);
+
+// Keeping a decoded record
+static int      _keepRecord(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Counting a decoded record without keeping it
+static int      _countRecord(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Timing every phase on a synthetic swarm and printing one JSON line
+static int      _benchScale(
+    size_t zerg);
+
+// Main Function for the benchmark harness
+int
+main(
+    int argc,
+    char *argv[])
+{
+    size_t          scales[] = { 100, 1000, 10000, 65000 };
+    int             err = 0;
+
+    // Scales can be given as args, otherwise the default ladder is run
+    if (argc > 1)
+    {
+        for (int i = 1; i < argc && !err; i++)
+        {
+            err = _benchScale(strtoul(argv[i], NULL, 10));
+        }
+    }
+    for (size_t i = 0; argc == 1 && i < sizeof(scales) / sizeof(*scales) &&
+         !err; i++)
+    {
+        err = _benchScale(scales[i]);
+    }
+
+    return err;
+}
+
+// Returning the monotonic clock in seconds
+static double
+_now(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Keeping a decoded record
+static int
+_keepRecord(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    struct _benchRecords *kept = ctx;
+
+    if (kept->count == kept->capacity)
+    {
+        size_t          capacity = kept->capacity ? kept->capacity * 2 : 1024;
+        struct zergRecord *records =
+            realloc(kept->records, capacity * sizeof(*records));
+
+        if (!records)
+        {
+            return INGESTMEMORY;
+        }
+        kept->records = records;
+        kept->capacity = capacity;
+    }
+    kept->records[kept->count++] = *rec;
+
+    return 0;
+}
+
+// Counting a decoded record without keeping it
+static int
+_countRecord(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    (void) rec;
+    (*(size_t *) ctx)++;
+
+    return 0;
+}
+
+/*
+ * The capture is written to a temporary file once. It is then decoded
+ * with the stdio reader, which also keeps the records, and again through
+ * the mapped reader, only counting them. The kept records build the graph
+ * so the edge and analysis phases don't include any decoding.
+ */
+
+// Timing every phase on a synthetic swarm and printing one JSON line
+static int
+_benchScale(
+    size_t zerg)
+{
+    struct synthOptions opts;
+    struct _benchRecords kept = { NULL, 0, 0 };
+    char            path[] = "/tmp/zergBenchXXXXXX";
+    int             fd = mkstemp(path);
+    FILE           *fp;
+    long            bytes;
+    size_t          mapped = 0;
+    size_t          objects = 0;
+    size_t          blocks = 0;
+    size_t          pairs = 0;
+    size_t          filtered = 0;
+    size_t          exact = 0;
+    double          start;
+    double          stdioTime;
+    double          mapTime;
+    double          edgeTime;
+    double          removeTime;
+    double          analyzeTime;
+    int             err;
+    graph           g;
+
+    if (fd < 0 || !(fp = fdopen(fd, "wb")))
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", path);
+        return 1;
+    }
+
+    synthDefaults(&opts);
+    opts.zerg = zerg;
+    opts.encaps = SYNTHALL;
+    opts.seed = BENCHSEED;
+    if (synthWrite(fp, &opts))
+    {
+        fprintf(stderr, "Invalid capture options\n");
+        fclose(fp);
+        unlink(path);
+        return 1;
+    }
+    bytes = ftell(fp);
+    fclose(fp);
+
+    // Decoding with the stdio reader and the mapped reader
+    start = _now();
+    err = ingestStdio(path, _keepRecord, &kept);
+    stdioTime = _now() - start;
+
+    start = _now();
+    err = err ? err : ingestFile(path, _countRecord, &mapped);
+    mapTime = _now() - start;
+
+    unlink(path);
+
+    // A capture that didn't decode, or decoded differently by each reader,
+    // has no rates worth printing
+    if (err || !kept.count || kept.count != mapped)
+    {
+        fprintf(stderr, err == INGESTMEMORY ? "Out of memory\n" :
+                "Unable to decode the capture\n");
+        free(kept.records);
+        return 1;
+    }
+
+    // Building the nodes and their edges
+    if (!(g = graphCreate()))
+    {
+        fprintf(stderr, "Out of memory\n");
+        free(kept.records);
+        return 1;
+    }
+    graphDeferEdges(g, true);
+    start = _now();
+    for (size_t i = 0; i < kept.count; i++)
+    {
+        ingestApply(g, &kept.records[i]);
+    }
+    graphBuildEdges(g);
+    edgeTime = _now() - start;
+    if (graphOutOfMemory(g))
+    {
+        fprintf(stderr, "Out of memory\n");
+        graphDestroy(g);
+        free(kept.records);
+        return 1;
+    }
+
+    start = _now();
+    graphRemoveBadNodes(g);
+    removeTime = _now() - start;
+
+    start = _now();
+    graphAnalyzeGraph(g);
+    analyzeTime = _now() - start;
+    if (graphOutOfMemory(g))
+    {
+        fprintf(stderr, "Out of memory\n");
+        graphDestroy(g);
+        free(kept.records);
+        return 1;
+    }
+
+    graphAllocCounts(g, &objects, &blocks);
+    graphPairCounts(g, &pairs, &filtered, &exact);
+    graphDestroy(g);
+    free(kept.records);
+
+    printf("{\"zerg\": %zu, \"packets\": %zu, \"bytes\": %ld, "
+           "\"decode_stdio_s\": %.6f, \"decode_stdio_pps\": %.0f, "
+           "\"decode_mmap_s\": %.6f, \"decode_mmap_pps\": %.0f, "
+           "\"edges_s\": %.6f, \"nodes_per_s\": %.0f, "
+           "\"remove_s\": %.6f, \"analyze_s\": %.6f, "
+           "\"pairs\": %zu, \"prefiltered\": %zu, \"exact\": %zu, "
+           "\"reject_rate\": %.4f, "
+           "\"alloc_objects\": %zu, \"alloc_blocks\": %zu}\n",
+           zerg, kept.count, bytes,
+           stdioTime, kept.count / stdioTime,
+           mapTime, mapped / mapTime,
+           edgeTime, zerg / edgeTime,
+           removeTime, analyzeTime, pairs, filtered, exact,
+           pairs ? (double) filtered / pairs : 0.0, objects, blocks);
+    fflush(stdout);
+
+    return 0;
+}
@@ -0,0 +1,573 @@
+/*  zergDaemon.c  */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "zergHeaders.h"
+#include "util.h"
+#include "graph.h"
+#include "zergStats.h"
+#include "zergDiag.h"
+#include "zergIngest.h"
+#include "pcapStream.h"
+#include "zergDaemon.h"
+
+#define DAEMONBATCH 64
+#define DAEMONDGRAM 512
+#define DAEMONRCVBUF (8 << 20)
+#define ZERGIDS 65536
+#define DAEMONWAIT 60000
+#define FOLLOWPOLL 250
+#define FOLLOWNOTES 4096
+#define FATHOM 1.8288
+
+// The latest GPS and status heard from a zerg
+struct _daemonZerg
+{
+    struct zergRecord gps;
+    struct zergRecord status;
+    bool            hasGps;
+    bool            hasStatus;
+};
+
+// Everything the daemon keeps between batches, all allocated up front
+struct _daemon
+{
+    struct _daemonZerg *zerg;
+    unsigned int   *order;
+    size_t          heard;
+    size_t          changes;
+    size_t          analyses;
+    struct pcapStream *streams;
+    size_t          followed;
+    int             watch;
+    char            notes[FOLLOWNOTES];
+    struct mmsghdr  msgs[DAEMONBATCH];
+    struct iovec    iovs[DAEMONBATCH];
+    unsigned char   dgrams[DAEMONBATCH][DAEMONDGRAM];
+};
+
+static volatile sig_atomic_t _stop;
+
+// Asking the receive loop to stop
+static void     _onSignal(
+    int sig);
+
+// Returning the monotonic clock in seconds
+static double   _now(
+    void);
+
+// Binding a UDP socket, returns -1 if it couldn't be
+static int      _bind(
+    const struct daemonOptions *opts);
+
+// Keeping a decoded record as the latest for its zerg
+static int      _keepLatest(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Receiving every datagram that is waiting, returns true on a socket error
+static bool     _drain(
+    int sock,
+    struct _daemon *d);
+
+// Opening and watching each file to follow, returns true if one couldn't
+// be opened
+static bool     _followOpen(
+    const struct daemonOptions *opts,
+    struct _daemon *d);
+
+// Closing every file being followed
+static void     _followClose(
+    struct _daemon *d);
+
+// Decoding every whole record appended to the followed files, returns true
+// on a read error or an invalid pcap header
+static bool     _followRead(
+    struct _daemon *d);
+
+// Building a graph from the latest records, analyzing and printing it,
+// returns true if it ran out of memory
+static bool     _analyze(
+    struct _daemon *d,
+    int minHp);
+
+// Setting the default daemon options
+void
+daemonDefaults(
+    struct daemonOptions *opts)
+{
+    opts->listen = false;
+    opts->address = NULL;
+    opts->port = ZERGPORT;
+    opts->follow = NULL;
+    opts->follows = 0;
+    opts->interval = DAEMONINTERVAL;
+    opts->changes = 0;
+    opts->minHp = 10;
+}
+
+/*
+ * Zerg keep sending, so only the latest GPS and status from each one is
+ * kept, in a table indexed by id that is allocated once. Ids are kept in
+ * the order they were first heard so each rebuilt graph has its nodes in
+ * the same order an offline run would. Records come from the socket, from
+ * captures that are still being written, or both. Followed captures are
+ * read once through before the first wait. The graph is rebuilt and
+ * analyzed once the interval has passed with changes pending, or as soon
+ * as the change threshold is hit.
+ */
+
+// Receiving Zerg datagrams and following captures, analyzing them until
+// SIGINT or SIGTERM, returns 1 if a source could not be set up or read
+int
+daemonRun(
+    const struct daemonOptions *opts)
+{
+    struct _daemon *d = calloc(1, sizeof(*d));
+    struct sigaction sa = { 0 };
+    struct pollfd   pfd[2];
+    double          deadline;
+    int             err = 0;
+    bool            ready;
+
+    if (!d)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    d->watch = -1;
+    d->zerg = calloc(ZERGIDS, sizeof(*d->zerg));
+    d->order = calloc(ZERGIDS, sizeof(*d->order));
+    pfd[0].fd = opts->listen ? _bind(opts) : -1;
+    pfd[0].events = POLLIN;
+    if (!d->zerg || !d->order)
+    {
+        fprintf(stderr, "Out of memory\n");
+        err = 1;
+    }
+    else if ((opts->listen && pfd[0].fd < 0) || _followOpen(opts, d) ||
+             _followRead(d))
+    {
+        err = 1;
+    }
+    ready = !err;
+    pfd[1].fd = d->watch;
+    pfd[1].events = POLLIN;
+
+    for (int i = 0; i < DAEMONBATCH; i++)
+    {
+        d->iovs[i].iov_base = d->dgrams[i];
+        d->iovs[i].iov_len = DAEMONDGRAM;
+        d->msgs[i].msg_hdr.msg_iov = &d->iovs[i];
+        d->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    // Interrupting poll on a signal so the loop can stop
+    _stop = 0;
+    sa.sa_handler = _onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    deadline = _now() + opts->interval;
+    while (!_stop && !err)
+    {
+        double          left = (deadline - _now()) * 1000;
+        int             wait = DAEMONWAIT;
+        double          start;
+
+        // A long interval is waited out a minute at a time so the wait in
+        // milliseconds always fits
+        if (left < wait)
+        {
+            wait = left;
+        }
+
+        // Files that can't be watched are checked on a timer instead
+        if (d->followed && d->watch < 0 && wait > FOLLOWPOLL)
+        {
+            wait = FOLLOWPOLL;
+        }
+        if (poll(pfd, 2, wait > 0 ? wait : 0) < 0 && errno != EINTR)
+        {
+            err = 1;
+            break;
+        }
+
+        start = statsNow();
+        if (pfd[0].revents & POLLIN)
+        {
+            err = _drain(pfd[0].fd, d);
+        }
+        if (pfd[1].revents & POLLIN)
+        {
+            while (read(d->watch, d->notes, sizeof(d->notes)) > 0)
+            {
+                continue;
+            }
+        }
+        if (!err && d->followed && (d->watch < 0 || pfd[1].revents & POLLIN))
+        {
+            err = _followRead(d);
+        }
+        statsTime(STATS_INGEST, start);
+
+        // Analyzing on the interval, or early once enough has changed
+        if ((opts->changes && d->changes >= opts->changes) ||
+            _now() >= deadline)
+        {
+            if (d->changes && _analyze(d, opts->minHp))
+            {
+                err = 1;
+                break;
+            }
+            deadline = _now() + opts->interval;
+        }
+    }
+
+    // Anything heard since the last analysis gets one more
+    if (ready && !err && d->changes && _analyze(d, opts->minHp))
+    {
+        err = 1;
+    }
+
+    if (pfd[0].fd >= 0)
+    {
+        close(pfd[0].fd);
+    }
+    _followClose(d);
+    free(d->zerg);
+    free(d->order);
+    free(d);
+
+    return err;
+}
+
+// Asking the receive loop to stop
+static void
+_onSignal(
+    int sig)
+{
+    (void) sig;
+    _stop = 1;
+}
+
+// Returning the monotonic clock in seconds
+static double
+_now(
+    void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Binding a UDP socket, returns -1 if it couldn't be
+static int
+_bind(
+    const struct daemonOptions *opts)
+{
+    struct sockaddr_in addr = { 0 };
+    int             sock = socket(AF_INET, SOCK_DGRAM, 0);
+    int             size = DAEMONRCVBUF;
+    int             on = 1;
+
+    if (sock < 0)
+    {
+        return -1;
+    }
+
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opts->port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (opts->address && inet_pton(AF_INET, opts->address, &addr.sin_addr) != 1)
+    {
+        fprintf(stderr, "Invalid address: %s\n", opts->address);
+        close(sock);
+        return -1;
+    }
+
+    // A large buffer rides out bursts between analyses
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)))
+    {
+        fprintf(stderr, "Unable to bind to port: %u\n", opts->port);
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+// Keeping a decoded record as the latest for its zerg
+static int
+_keepLatest(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    struct _daemon *d = ctx;
+    unsigned int    id = rec->zHead.details.source;
+    struct _daemonZerg *z = &d->zerg[id];
+    bool            first = !z->hasGps && !z->hasStatus;
+
+    if (getZType(&rec->zHead) == ZERGGPS)
+    {
+        // Checking bounds once here instead of on every rebuild
+        struct gpsH     check = rec->payload.gps;
+
+        check.altitude *= FATHOM;
+        if (notValidGPS(&check))
+        {
+            diagReport(DIAG_BOUNDS);
+            return 0;
+        }
+        z->gps = *rec;
+        z->hasGps = true;
+    }
+    else
+    {
+        z->status = *rec;
+        z->hasStatus = true;
+    }
+
+    // An id is only placed once something from it has been kept
+    if (first)
+    {
+        d->order[d->heard++] = id;
+    }
+    d->changes++;
+
+    return 0;
+}
+
+// Receiving every datagram that is waiting, returns true on a socket error
+static bool
+_drain(
+    int sock,
+    struct _daemon *d)
+{
+    int             got;
+
+    do
+    {
+        got = recvmmsg(sock, d->msgs, DAEMONBATCH, MSG_DONTWAIT, NULL);
+        if (got < 0)
+        {
+            return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+        }
+
+        for (int i = 0; i < got; i++)
+        {
+            statsRead(1, d->msgs[i].msg_len);
+            ingestDatagram(d->dgrams[i], d->msgs[i].msg_len, _keepLatest, d);
+        }
+    } while (got == DAEMONBATCH);
+
+    return false;
+}
+
+// Opening and watching each file to follow, returns true if one couldn't
+// be opened
+static bool
+_followOpen(
+    const struct daemonOptions *opts,
+    struct _daemon *d)
+{
+    if (!opts->follows)
+    {
+        return false;
+    }
+
+    d->streams = calloc(opts->follows, sizeof(*d->streams));
+    if (!d->streams)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return true;
+    }
+
+    // Without inotify every file is polled instead
+    d->watch = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    for (size_t i = 0; i < opts->follows; i++)
+    {
+        int             fd = open(opts->follow[i], O_RDONLY);
+
+        if (fd < 0)
+        {
+            fprintf(stderr, "Unable to open the file: %s\n", opts->follow[i]);
+            return true;
+        }
+        if (streamOpen(&d->streams[i], fd))
+        {
+            fprintf(stderr, "Out of memory\n");
+            close(fd);
+            return true;
+        }
+        d->followed++;
+
+        if (d->watch >= 0 &&
+            inotify_add_watch(d->watch, opts->follow[i], IN_MODIFY) < 0)
+        {
+            close(d->watch);
+            d->watch = -1;
+        }
+    }
+
+    return false;
+}
+
+// Closing every file being followed
+static void
+_followClose(
+    struct _daemon *d)
+{
+    for (size_t i = 0; i < d->followed; i++)
+    {
+        close(d->streams[i].fd);
+        streamClose(&d->streams[i]);
+    }
+    if (d->watch >= 0)
+    {
+        close(d->watch);
+    }
+    free(d->streams);
+}
+
+// Decoding every whole record appended to the followed files, returns true
+// on a read error or an invalid pcap header
+static bool
+_followRead(
+    struct _daemon *d)
+{
+    for (size_t i = 0; i < d->followed; i++)
+    {
+        struct pcapStream *s = &d->streams[i];
+        struct span     packet;
+        struct stat     info;
+        ssize_t         got;
+        int             next;
+
+        // A partial record at the tail stays buffered until it is finished
+        do
+        {
+            while ((next = streamNext(s, &packet)) > 0)
+            {
+                ingestPacket(packet.data, packet.length, _keepLatest, d);
+            }
+            if (next < 0)
+            {
+                return true;
+            }
+        } while ((got = streamFill(s)) > 0);
+
+        if (got < 0)
+        {
+            fprintf(stderr, "Unable to read the file being followed\n");
+            return true;
+        }
+
+        // A capture truncated in place is read again from its header
+        if (!fstat(s->fd, &info) && (size_t) info.st_size < s->offset)
+        {
+            lseek(s->fd, 0, SEEK_SET);
+            streamReset(s);
+            i--;
+        }
+    }
+
+    return false;
+}
+
+// Building a graph from the latest records, analyzing and printing it,
+// returns true if it ran out of memory
+static bool
+_analyze(
+    struct _daemon *d,
+    int minHp)
+{
+    graph           g = graphCreate();
+    size_t          before;
+    size_t          unused;
+    double          start;
+    double          built;
+
+    if (!g)
+    {
+        fprintf(stderr, "Out of memory\n");
+        return true;
+    }
+    graphDeferEdges(g, true);
+
+    // The graph converts altitude in place, so it gets a copy
+    start = statsNow();
+    for (size_t i = 0; i < d->heard; i++)
+    {
+        struct _daemonZerg *z = &d->zerg[d->order[i]];
+        struct zergRecord rec;
+
+        if (z->hasStatus)
+        {
+            ingestApply(g, &z->status);
+        }
+        if (z->hasGps)
+        {
+            rec = z->gps;
+            ingestApply(g, &rec);
+        }
+    }
+
+    // ingestApply times the build, which counts as ingest for captures too
+    built = statsNow();
+    graphBuildEdges(g);
+    statsTime(STATS_BUILD, built);
+    statsTime(STATS_INGEST, start);
+
+    // Counts describe the most recent analysis, timings all of them
+    graphCounts(g, &before, &unused, &unused);
+    start = statsNow();
+    graphRemoveBadNodes(g);
+    statsTime(STATS_REMOVE, start);
+    start = statsNow();
+    graphAnalyzeGraph(g);
+    statsTime(STATS_ANALYZE, start);
+
+    // A graph missing records would print the wrong removals
+    if (graphOutOfMemory(g))
+    {
+        fprintf(stderr, "Out of memory\n");
+        graphDestroy(g);
+        return true;
+    }
+    graphCounts(g, &zergStats.nodes, &zergStats.edges, &zergStats.invalid);
+    graphPairCounts(g, &zergStats.pairs, &zergStats.filtered,
+                    &zergStats.exact);
+    zergStats.dropped = before - zergStats.nodes;
+
+    start = statsNow();
+    printf("\nANALYSIS %zu (%zu ZERG, %zu UPDATES)\n", ++d->analyses,
+           d->heard, d->changes);
+    graphPrint(g);
+    graphPrintLowHP(g, minHp);
+    fflush(stdout);
+    statsTime(STATS_PRINT, start);
+
+    graphDestroy(g);
+    d->changes = 0;
+
+    return false;
+}
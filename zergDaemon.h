@@ -0,0 +1,33 @@
+/*  zergDaemon.h  */
+
+#ifndef ZERGDAEMON_H
+#define ZERGDAEMON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define DAEMONINTERVAL 1.0
+
+// Where the daemon listens, what it follows and how often it analyzes
+struct daemonOptions
+{
+    bool            listen;
+    const char     *address;
+    unsigned int    port;
+    char          **follow;
+    size_t          follows;
+    double          interval;
+    size_t          changes;
+    int             minHp;
+};
+
+// Setting the default daemon options
+void            daemonDefaults(
+    struct daemonOptions *opts);
+
+// Receiving Zerg datagrams and following captures, analyzing them until
+// SIGINT or SIGTERM, returns 1 if a source could not be set up or read
+int             daemonRun(
+    const struct daemonOptions *opts);
+
+#endif
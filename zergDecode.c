@@ -11,11 +11,23 @@
 
 #define MINPCAPLENGTH 54
 
-// Reads IPV6 data and returns true if it's invalid
-static bool     _readIPV6(
+// Reads IPV6 data, returns 1 if the packet was skipped and -1 on a read error
+static int      _readIPV6(
     FILE * fp,
     unsigned int *skipBytes);
 
+// Reading the Ethernet header after an 802.1Q tag, returns true on a read error
+static bool     _readTag(
+    FILE * fp,
+    union ethernetH *eHeader,
+    unsigned int *skipBytes);
+
+// Skipping the rest of a packet, returns 1 or -1 if the seek failed
+static int      _skipPacket(
+    FILE * fp,
+    enum diagReason reason,
+    unsigned int skipBytes);
+
 // Reading in PCAP header and returning true if it's invalid 
 bool
 invalidPCAPHeader(
@@ -25,9 +37,11 @@ invalidPCAPHeader(
     struct pcapFileH pHeader;
 
     // Reading the first header of the file
-    if (setPcapHead(fp, &pHeader, "Packet is corrupted or empty"))
+    (*swap) = setPcapHead(fp, &pHeader, "Packet is corrupted or empty");
+    if ((*swap) < 0)
     {
-        (*swap) = 1;
+        fclose(fp);
+        return true;
     }
 
     // Checking for valid PCAP Header
@@ -42,8 +56,9 @@ invalidPCAPHeader(
     return false;
 }
 
-// Reading in Zerg Header and returning true if header is invalid
-bool
+// Reading in Zerg Header, returns 1 if the packet was skipped and -1 on a
+// read error
+int
 invalidZergHeader(
     FILE * fp,
     union zergH * zHeader,
@@ -52,27 +67,32 @@ invalidZergHeader(
     struct udpH     udpHeader;
 
     // Reading UDP and Zerg
-    setUDPHead(fp, &udpHeader, "UDP Header");
+    if (setUDPHead(fp, &udpHeader, "UDP Header"))
+    {
+        return -1;
+    }
     (*skipBytes) -= sizeof(udpHeader);
     if (udpHeader.dport != ZERGPORT)
     {
-        skipAhead(fp, 1, "Invalid Destination port", (*skipBytes));
-        return true;
+        return _skipPacket(fp, DIAG_PORT, (*skipBytes));
     }
 
-    setZergH(fp, zHeader, "Zerg Header");
+    if (setZergH(fp, zHeader, "Zerg Header"))
+    {
+        return -1;
+    }
     (*skipBytes) -= sizeof(*zHeader);
     if ((*zHeader).details.version != 1)
     {
-        skipAhead(fp, 1, "Invalid Zerg Version", (*skipBytes));
-        return true;
+        return _skipPacket(fp, DIAG_VERSION, (*skipBytes));
     }
 
-    return false;
+    return 0;
 }
 
-// Reading in ethernet and ip headers and returning true if something is invalid
-bool
+// Reading in ethernet and ip headers, returns 1 if the packet was skipped and
+// -1 on a read error
+int
 invalidEthOrIp(
     FILE * fp,
     unsigned int ppLength,
@@ -84,28 +104,29 @@ invalidEthOrIp(
     // Checking if packet is of a valid length
     if (ppLength < MINPCAPLENGTH)
     {
-        skipAhead(fp, 1, "Invalid Packet Header", (*skipBytes));
-        return true;
+        return _skipPacket(fp, DIAG_PACKETHEAD, (*skipBytes));
     }
 
     // Reading Ethernet Header
-    setEthHead(fp, &eHeader, "Ethernet Header");
-    (*skipBytes) -= (sizeof(eHeader) + ETHCORRECTION);
-
-    // Checking if it's 802.1Q
-    if (eHeader.ethInfo.type == ETH8021Q)
+    if (setEthHead(fp, &eHeader, "Ethernet Header"))
     {
-        skipAhead(fp, 0, "", ETH8021CORRECTION);
-        setEthHead(fp, &eHeader, "Ethernet 802.1Q Header");
+        return -1;
     }
-    else if (eHeader.ethInfo.type == ETH8021Q4)
+    (*skipBytes) -= (sizeof(eHeader) + ETHCORRECTION);
+
+    // Checking if it's 802.1Q, each tag moves the cursor forward 4 bytes
+    if (eHeader.ethInfo.type == ETH8021Q || eHeader.ethInfo.type == ETH8021Q4)
     {
-        skipAhead(fp, 0, "", ETH8021CORRECTION);
-        setEthHead(fp, &eHeader, "Ethernet 802.1Q Header");
-        if (eHeader.ethInfo.type == ETH8021Q)
+        bool            qinq = eHeader.ethInfo.type == ETH8021Q4;
+
+        if (_readTag(fp, &eHeader, skipBytes))
+        {
+            return -1;
+        }
+        if (qinq && eHeader.ethInfo.type == ETH8021Q &&
+            _readTag(fp, &eHeader, skipBytes))
         {
-            skipAhead(fp, 0, "", ETH8021CORRECTION);
-            setEthHead(fp, &eHeader, "Ethernet 802.1Q Header");
+            return -1;
         }
     }
 
@@ -113,7 +134,10 @@ invalidEthOrIp(
     if (eHeader.ethInfo.type == ETHIPV4)
     {
         // Reading IP Header
-        setIPv4Head(fp, &ipHeader, "IP Header");
+        if (setIPv4Head(fp, &ipHeader, "IP Header"))
+        {
+            return -1;
+        }
         (*skipBytes) -= sizeof(ipHeader);
 
         // Checking if valid IP Header
@@ -121,8 +145,7 @@ invalidEthOrIp(
             (ipHeader.proto != UDP && ipHeader.proto != IP6INIP4) ||
             ipHeader.ihl < IHLDEFAULT)
         {
-            skipAhead(fp, 1, "Invalid IPv4 Header", (*skipBytes));
-            return true;
+            return _skipPacket(fp, DIAG_IPV4, (*skipBytes));
         }
         // Moving cursors forward if there are options
         else if (ipHeader.ihl > IHLDEFAULT)
@@ -131,48 +154,36 @@ invalidEthOrIp(
 
             if (ppLength < (MINPCAPLENGTH + ihl))
             {
-                (*skipBytes) -= ihl;
-                fseek(fp, ihl, SEEK_CUR);
+                return _skipPacket(fp, DIAG_IPLENGTH, (*skipBytes));
             }
-            else
+            (*skipBytes) -= ihl;
+            if (skipAhead(fp, DIAG_NONE, ihl))
             {
-                skipAhead(fp, 1, "Invalid Packet Header Data length",
-                          (*skipBytes));
-                return true;
+                return -1;
             }
         }
 
         // Checking for 6in4
         if (ipHeader.proto == IP6INIP4)
         {
-            // Reading in IPV6
-            if (_readIPV6(fp, skipBytes))
-            {
-                return true;
-            }
+            return _readIPV6(fp, skipBytes);
         }
     }
     // Checking if it is IPv6
     else if (eHeader.ethInfo.type == ETHIPV6)
     {
-        // Reading in IPV6
-        if (_readIPV6(fp, skipBytes))
-        {
-            return true;
-        }
+        return _readIPV6(fp, skipBytes);
     }
     else
     {
-        skipAhead(fp, 1, "Invalid Ethernet Header Type", (*skipBytes));
-        return true;
-
+        return _skipPacket(fp, DIAG_ETHTYPE, (*skipBytes));
     }
 
-    return false;
+    return 0;
 }
 
-// Reads IPV6 data and returns true if it's invalid
-static bool
+// Reads IPV6 data, returns 1 if the packet was skipped and -1 on a read error
+static int
 _readIPV6(
     FILE * fp,
     unsigned int *skipBytes)
@@ -180,15 +191,88 @@ _readIPV6(
     struct ipv6H    ip6Header;
 
     //ip6Header
-    setIPv6Head(fp, &ip6Header, "IPv6 Header");
+    if (setIPv6Head(fp, &ip6Header, "IPv6 Header"))
+    {
+        return -1;
+    }
     (*skipBytes) -= sizeof(ip6Header);
 
     // Checking if valid IP Header
     if (ip6Header.nextHead != UDP)
     {
-        skipAhead(fp, 1, "Invalid Transport Layer protocol", (*skipBytes));
+        return _skipPacket(fp, DIAG_TRANSPORT, (*skipBytes));
+    }
+
+    return 0;
+}
+
+// Reading the Ethernet header after an 802.1Q tag, returns true on a read error
+static bool
+_readTag(
+    FILE * fp,
+    union ethernetH *eHeader,
+    unsigned int *skipBytes)
+{
+    if (skipAhead(fp, DIAG_NONE, ETH8021CORRECTION) ||
+        setEthHead(fp, eHeader, "Ethernet 802.1Q Header"))
+    {
         return true;
     }
+    (*skipBytes) -= (sizeof(*eHeader) + ETHCORRECTION + ETH8021CORRECTION);
 
     return false;
 }
+
+// Skipping the rest of a packet, returns 1 or -1 if the seek failed
+static int
+_skipPacket(
+    FILE * fp,
+    enum diagReason reason,
+    unsigned int skipBytes)
+{
+    return skipAhead(fp, reason, skipBytes) ? -1 : 1;
+}
+
+// Validating PCAP header in a span and returning true if it's invalid, what
+// was wrong is printed to errors unless it is NULL
+bool
+invalidPCAPHeaderSpan(
+    struct span *s,
+    int *swap,
+    FILE * errors)
+{
+    struct pcapFileH pHeader;
+
+    // Reading the first header of the file
+    if (spanRead(s, &pHeader, sizeof(pHeader)))
+    {
+        if (errors)
+        {
+            fprintf(errors, "READ ERROR AT: %s\n",
+                    "Packet is corrupted or empty");
+        }
+        return true;
+    }
+
+    if (pHeader.fileType == PCAPFILETYPE)
+    {
+        pHeader.majVer = u16BitSwap(pHeader.majVer);
+        pHeader.minVer = u16BitSwap(pHeader.minVer);
+        pHeader.linkType = u32BitSwap(pHeader.linkType);
+        (*swap) = 1;
+    }
+
+    // Checking for valid PCAP Header
+    if ((pHeader.majVer != PCAPHEADMAJ) || (pHeader.minVer != PCAPHEADMIN) ||
+        (pHeader.linkType != PCAPHEADLINK))
+    {
+        if (errors)
+        {
+            fprintf(errors, "Invalid PCAP Version\n");
+        }
+        return true;
+    }
+
+    return false;
+}
+
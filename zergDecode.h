@@ -5,14 +5,18 @@
 
 #include <stdbool.h>
 
-// Reading in ethernet and ip headers and returning true if something is invalid
-bool            invalidEthOrIp(
+struct span;
+
+// Reading in ethernet and ip headers, returns 1 if the packet was skipped and
+// -1 on a read error
+int             invalidEthOrIp(
     FILE * fp,
     unsigned int ppLength,
     unsigned int *skipBytes);
 
-// Reading in Zerg Header and returning true if header is invalid
-bool            invalidZergHeader(
+// Reading in Zerg Header, returns 1 if the packet was skipped and -1 on a
+// read error
+int             invalidZergHeader(
     FILE * fp,
     union zergH *zHeader,
     unsigned int *skipBytes);
@@ -22,4 +26,11 @@ bool            invalidPCAPHeader(
     FILE * fp,
     int *swap);
 
+// Validating PCAP header in a span and returning true if it's invalid, what
+// was wrong is printed to errors unless it is NULL
+bool            invalidPCAPHeaderSpan(
+    struct span *s,
+    int *swap,
+    FILE * errors);
+
 #endif
@@ -0,0 +1,98 @@
+/*  zergDiag.c  */
+#include <stdio.h>
+
+#include "zergDiag.h"
+
+// Messages for each of the reasons
+const char     *diagMsg[DIAG_REASONS] = {
+    "",
+    "Invalid Packet Header",
+    "Invalid Ethernet Header Type",
+    "Invalid IPv4 Header",
+    "Invalid Packet Header Data length",
+    "Invalid Transport Layer protocol",
+    "Invalid Destination port",
+    "Invalid Zerg Version",
+    "Invalid Zerg payload",
+    "A payload error occurred",
+    "Out of bounds payload"
+};
+
+static enum diagLevel _level = DIAG_SUMMARY;
+static unsigned int _sample = DIAGSAMPLE;
+static struct diagCounters _totals;
+
+// Where this thread's counts go, NULL for the totals
+static _Thread_local struct diagCounters *_local;
+
+// Setting the level, verbose prints every sample'th time a reason is seen
+void
+diagSetLevel(
+    enum diagLevel level,
+    unsigned int sample)
+{
+    _level = level;
+    _sample = sample ? sample : 1;
+}
+
+// Sending this thread's counts to c, or back to the totals when c is NULL
+void
+diagUse(
+    struct diagCounters *c)
+{
+    _local = c;
+}
+
+// Adding a set of counters into the totals
+void
+diagMerge(
+    const struct diagCounters *c)
+{
+    for (int i = 0; i < DIAG_REASONS; i++)
+    {
+        _totals.reasons[i] += c->reasons[i];
+    }
+}
+
+// Counting a reason, and printing it if it is sampled
+void
+diagReport(
+    enum diagReason reason)
+{
+    struct diagCounters *c = _local ? _local : &_totals;
+    size_t          seen = c->reasons[reason]++;
+
+    // A skipped packet only costs a write when verbose picks it
+    if (_level == DIAG_VERBOSE && seen % _sample == 0)
+    {
+        fprintf(stderr, "Skipping Packet: %s (%zu seen)\n", diagMsg[reason],
+                seen + 1);
+    }
+}
+
+// Returning the total count for a reason
+size_t
+diagCount(
+    enum diagReason reason)
+{
+    return _totals.reasons[reason];
+}
+
+// Printing how many times each reason was seen, unless quiet
+void
+diagSummary(
+    FILE * fp)
+{
+    if (_level == DIAG_QUIET)
+    {
+        return;
+    }
+
+    for (int i = DIAG_NONE + 1; i < DIAG_REASONS; i++)
+    {
+        if (_totals.reasons[i])
+        {
+            fprintf(fp, "Skipped %zu: %s\n", _totals.reasons[i], diagMsg[i]);
+        }
+    }
+}
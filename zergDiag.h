@@ -0,0 +1,70 @@
+/*  zergDiag.h  */
+
+#ifndef ZERGDIAG_H
+#define ZERGDIAG_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define DIAGSAMPLE 1000
+
+// Reasons a packet or payload is skipped, DIAG_NONE skips without one
+enum diagReason
+{
+    DIAG_NONE = 0,
+    DIAG_PACKETHEAD,
+    DIAG_ETHTYPE,
+    DIAG_IPV4,
+    DIAG_IPLENGTH,
+    DIAG_TRANSPORT,
+    DIAG_PORT,
+    DIAG_VERSION,
+    DIAG_PAYLOADTYPE,
+    DIAG_PAYLOAD,
+    DIAG_BOUNDS,
+    DIAG_REASONS
+};
+
+// How much is printed, the summary is the default
+enum diagLevel
+{
+    DIAG_QUIET = 0,
+    DIAG_SUMMARY,
+    DIAG_VERBOSE
+};
+
+// Counts for each reason, each decoding thread has its own set
+struct diagCounters
+{
+    size_t          reasons[DIAG_REASONS];
+};
+
+// Messages for each of the reasons
+extern const char *diagMsg[DIAG_REASONS];
+
+// Setting the level, verbose prints every sample'th time a reason is seen
+void            diagSetLevel(
+    enum diagLevel level,
+    unsigned int sample);
+
+// Sending this thread's counts to c, or back to the totals when c is NULL
+void            diagUse(
+    struct diagCounters *c);
+
+// Adding a set of counters into the totals
+void            diagMerge(
+    const struct diagCounters *c);
+
+// Counting a reason, and printing it if it is sampled
+void            diagReport(
+    enum diagReason reason);
+
+// Returning the total count for a reason
+size_t          diagCount(
+    enum diagReason reason);
+
+// Printing how many times each reason was seen, unless quiet
+void            diagSummary(
+    FILE * fp);
+
+#endif
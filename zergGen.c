@@ -0,0 +1,172 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "zergHeaders.h"
+#include "zergSynth.h"
+
+#define SENDPAUSE 1000
+
+// Connecting a UDP socket to host[:port], returns -1 if it couldn't be
+static int      _connect(
+    char *dest);
+
+// Main Function for the capture generator
+int
+main(
+    int argc,
+    char *argv[])
+{
+    // Initializing Variables
+    struct synthOptions opts;
+    FILE           *fp;
+    int             err;
+    int             sock;
+    bool            send = false;
+    unsigned int    pause = SENDPAUSE;
+
+    synthDefaults(&opts);
+
+    // Setting getopt to not display errors
+    opterr = 0;
+    int             optCode;
+
+    // Looping through each flag
+    while ((optCode = getopt(argc, argv, "a:bc:d:e:n:r:s:uw:")) != -1)
+    {
+        switch (optCode)
+        {
+        case 'a':
+            opts.altitude = strtod(optarg, NULL);
+            break;
+        case 'b':
+            opts.swap = 1;
+            break;
+        case 'c':
+            opts.corruptRate = strtod(optarg, NULL);
+            break;
+        case 'd':
+            opts.density = strtod(optarg, NULL);
+            break;
+        case 'e':
+            if (synthParseEncaps(optarg, &opts.encaps))
+            {
+                fprintf(stderr, "Unknown encapsulation list %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'n':
+            opts.zerg = strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            opts.statusRatio = strtod(optarg, NULL);
+            break;
+        case 's':
+            opts.seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'u':
+            send = true;
+            break;
+        case 'w':
+            pause = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "Unknown flag -%c\n", optopt);
+            return 1;
+        }
+    }
+
+    // Checking for valid amount for args
+    if ((argc - optind) != 1)
+    {
+        fprintf(stderr, "Invalid amount of args\n");
+        return 1;
+    }
+
+    // Sending the swarm as datagrams instead of writing a capture
+    if (send)
+    {
+        if ((sock = _connect(argv[optind])) < 0)
+        {
+            fprintf(stderr, "Unable to connect to: %s\n", argv[optind]);
+            return 1;
+        }
+        err = synthSend(sock, &opts, pause);
+        if (err)
+        {
+            fprintf(stderr, "Invalid capture options or send failed\n");
+        }
+        close(sock);
+
+        return err;
+    }
+
+    // Writing to stdout when the file is -
+    if (!strcmp(argv[optind], "-"))
+    {
+        fp = stdout;
+    }
+    else if (!(fp = fopen(argv[optind], "wb")))
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", argv[optind]);
+        return 1;
+    }
+
+    err = synthWrite(fp, &opts);
+    if (err)
+    {
+        fprintf(stderr, "Invalid capture options\n");
+    }
+
+    if (fp != stdout)
+    {
+        fclose(fp);
+    }
+
+    return err;
+}
+
+// Connecting a UDP socket to host[:port], returns -1 if it couldn't be
+static int
+_connect(
+    char *dest)
+{
+    struct addrinfo hints = { 0 };
+    struct addrinfo *found;
+    char            port[8];
+    char           *colon = strrchr(dest, ':');
+    int             sock = -1;
+
+    // The Zerg port is used when none is given
+    snprintf(port, sizeof(port), "%u", ZERGPORT);
+    if (colon)
+    {
+        *colon = '\0';
+        snprintf(port, sizeof(port), "%s", colon + 1);
+    }
+
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(dest, port, &hints, &found))
+    {
+        return -1;
+    }
+
+    for (struct addrinfo * a = found; a && sock < 0; a = a->ai_next)
+    {
+        sock = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (sock >= 0 && connect(sock, a->ai_addr, a->ai_addrlen))
+        {
+            close(sock);
+            sock = -1;
+        }
+    }
+    freeaddrinfo(found);
+
+    return sock;
+}
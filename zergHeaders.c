@@ -16,6 +16,18 @@ const char     *zergGPSKey[6] =
     { "latitude", "longitude", "altitude", "bearing", "speed", "accuracy" };
 const char     *zergComKey[2] = { "par1", "par2" };
 
+// Swapping the Header Struct into host order
+static void     _swapZergH(
+    union zergH *zHead);
+
+// Swapping the Status Header into host order
+static void     _swapZStatus(
+    struct statusH *status);
+
+// Swapping the GPS Header into host order
+static void     _swapZGPS(
+    struct gpsH *gps);
+
 // Reading in data based off it's length
 int
 setZMsg(
@@ -39,80 +51,88 @@ setZMsg(
     return 0;
 }
 
-// Reading in and setting Command Struct
+// Reading in and setting Command Struct, returns 1 if it came up short
 int
 setZCommand(
     FILE * fp,
     struct commandH *command,
     size_t length)
 {
-    fread(command, length, 1, fp);
+    unsigned char   raw[sizeof(*command)] = { 0 };
+    unsigned int    code;
+
+    if (length < ZCOMMANDLENGTH || length > sizeof(raw) ||
+        fread(raw, ZCOMMANDLENGTH, 1, fp) != 1)
+    {
+        return 1;
+    }
 
-    command->command = u16BitSwap(command->command);
-    if ((command->command % 2) == 0 || command->command == 0)
+    // Only odd commands carry parameters, so they are only read then and
+    // the file never has to back up
+    code = raw[0] << 8 | raw[1];
+    if ((code % 2) &&
+        fread(raw + ZCOMMANDLENGTH, length - ZCOMMANDLENGTH, 1, fp) != 1)
     {
-        fseek(fp, -6, SEEK_CUR);
+        return 1;
     }
+
+    memcpy(command, raw, sizeof(*command));
+    command->command = code;
     command->par1 = u16BitSwap(command->par1);
     s32BitSwap(&command->par2);
 
     return 0;
 }
 
-// Reading in and setting Header Stuct
-void
+// Reading in and setting Header Stuct, returns true if it came up short
+bool
 setZergH(
     FILE * fp,
     union zergH *zHead,
     const char *msg)
 {
+    if (safeRead(fp, zHead, sizeof(*zHead), msg))
+    {
+        return true;
+    }
 
-    safeRead(fp, zHead, sizeof(*zHead), msg);
+    _swapZergH(zHead);
 
-    zHead->details.length = u24BitSwap(zHead->details.length);
-    zHead->details.source = u16BitSwap(zHead->details.source);
-    zHead->details.destination = u16BitSwap(zHead->details.destination);
-    zHead->details.sequence = u32BitSwap(zHead->details.sequence);
+    return false;
 }
 
-// Reading in and setting Status Header
+// Reading in and setting Status Header, returns 1 if it came up short
 int
 setZStatus(
     FILE * fp,
     struct statusH *status,
     size_t length)
 {
+    if (fread(status, length, 1, fp) != 1)
+    {
+        return 1;
+    }
 
-    fread(status, length, 1, fp);
-
-    status->hp = u24BitSwap(status->hp);
-    status->armor = u8BitSwap(status->armor);
-    status->maxHp = u24BitSwap(status->maxHp);
-    s32BitSwap(&status->speed);
+    _swapZStatus(status);
 
     return 0;
-
 }
 
-// Reading in and setting Zerg Header
+// Reading in and setting Zerg Header, returns 1 if it came up short
 int
 setZGPS(
     FILE * fp,
     struct gpsH *gps,
     size_t length)
 {
+    if (fread(gps, length, 1, fp) != 1)
+    {
+        return 1;
+    }
 
-    fread(gps, length, 1, fp);
-
-    s64BitSwap(&gps->longitude);
-    s64BitSwap(&gps->latitude);
-    s32BitSwap(&gps->altitude);
-    s32BitSwap(&gps->bearing);
-    s32BitSwap(&gps->speed);
-    s32BitSwap(&gps->accuracy);
+    _swapZGPS(gps);
 
     return 0;
-
 }
 
 // Returing the header Type
@@ -122,3 +142,38 @@ getZType(
 {
     return zHead->details.type;
 }
+
+// Swapping the Header Struct into host order
+static void
+_swapZergH(
+    union zergH *zHead)
+{
+    zHead->details.length = u24BitSwap(zHead->details.length);
+    zHead->details.source = u16BitSwap(zHead->details.source);
+    zHead->details.destination = u16BitSwap(zHead->details.destination);
+    zHead->details.sequence = u32BitSwap(zHead->details.sequence);
+}
+
+// Swapping the Status Header into host order
+static void
+_swapZStatus(
+    struct statusH *status)
+{
+    status->hp = u24BitSwap(status->hp);
+    status->armor = u8BitSwap(status->armor);
+    status->maxHp = u24BitSwap(status->maxHp);
+    s32BitSwap(&status->speed);
+}
+
+// Swapping the GPS Header into host order
+static void
+_swapZGPS(
+    struct gpsH *gps)
+{
+    s64BitSwap(&gps->longitude);
+    s64BitSwap(&gps->latitude);
+    s32BitSwap(&gps->altitude);
+    s32BitSwap(&gps->bearing);
+    s32BitSwap(&gps->speed);
+    s32BitSwap(&gps->accuracy);
+}
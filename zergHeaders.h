@@ -3,13 +3,18 @@
 #ifndef ZERGHEADERS_H
 #define ZERGHEADERS_H
 
+#include <stdbool.h>
+
 #define ZERGPORT 0xea7
+#define ZCOMMANDLENGTH 2
+#define ZERGSTATUS 1
+#define ZERGGPS 3
 
-const char     *zergHKey[4];
-const char     *zergMsgKey[1];
-const char     *zergStatKey[5];
-const char     *zergGPSKey[6];
-const char     *zergComKey[2];
+extern const char *zergHKey[4];
+extern const char *zergMsgKey[1];
+extern const char *zergStatKey[5];
+extern const char *zergGPSKey[6];
+extern const char *zergComKey[2];
 
 union zergH
 {
@@ -26,7 +31,7 @@ union zergH
 
     char            raw[12];
 
-} header;
+};
 
 struct statusH
 {
@@ -35,7 +40,7 @@ struct statusH
     unsigned int    maxHp:24;
     unsigned int    type:8;
     float           speed;
-} status;
+};
 
 struct commandH
 {
@@ -44,7 +49,7 @@ struct commandH
     unsigned int    par1:16;
     unsigned int    par2;
 
-} command;
+};
 
 struct gpsH
 {
@@ -56,14 +61,14 @@ struct gpsH
     float           speed;
     float           accuracy;
 
-} gps;
+};
 
 struct DMS
 {
     unsigned int    degrees;
     unsigned int    minutes;
     unsigned int    seconds;
-} DMS;
+};
 
 struct GPS
 {
@@ -71,7 +76,18 @@ struct GPS
     struct DMS      lon;
 };
 
-void            setZergH(
+// A decoded Zerg header along with its payload
+struct zergRecord
+{
+    union zergH     zHead;
+    union
+    {
+        struct gpsH     gps;
+        struct statusH  status;
+    } payload;
+};
+
+bool            setZergH(
     FILE * fp,
     union zergH *zHead,
     const char *msg);
@@ -0,0 +1,1108 @@
+/*  zergIngest.c  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "zergHeaders.h"
+#include "netHeaders.h"
+#include "zergDecode.h"
+#include "zergParse.h"
+#include "util.h"
+#include "pcapMap.h"
+#include "pcapStream.h"
+#include "pcapUnpack.h"
+#include "graph.h"
+#include "zergStats.h"
+#include "zergDiag.h"
+#include "zergIngest.h"
+
+#define PCAPFILELENGTH 24
+#define PCAPMAXSNAP 262144
+#define CHUNKMIN (8 << 20)
+#define CHUNKCHAIN 8
+#define INGESTBLOCK 64
+
+// A byte range of a file being decoded by a worker and the records it produced
+struct _ingestJob
+{
+    const struct span *file;
+    const char     *path;
+    int             swap;
+    size_t          from;
+    size_t          to;
+    size_t          start;
+    size_t          next;
+    struct zergRecord *records;
+    size_t          count;
+    size_t          capacity;
+    int             err;
+    bool            done;
+    struct statsCounters counters;
+    struct diagCounters diag;
+} _ingestJob;
+
+// The chunks shared between the workers
+struct _ingestPool
+{
+    struct _ingestJob *jobs;
+    size_t          count;
+    size_t          next;
+    bool            stop;
+    pthread_mutex_t lock;
+    pthread_cond_t  ready;
+} _ingestPool;
+
+// Decoding chunks until there are none left
+static void    *_ingestWorker(
+    void *arg);
+
+// Decoding the last length bytes of a file read with stdio, for a record the
+// file ended partway through, returns 2 on a duplicate, 1 on a read error and
+// INGESTMEMORY if it ran out of memory
+static int      _ingestTail(
+    FILE * fp,
+    size_t length,
+    ingestEmit emit,
+    void *ctx);
+
+// Opening a file and decoding it as a stream
+static int      _ingestPath(
+    const char *path,
+    ingestEmit emit,
+    void *ctx);
+
+// Decoding the payload of a validated packet and handing it on
+static int      _emitPacket(
+    const struct zergPacket *pkt,
+    ingestEmit emit,
+    void *ctx);
+
+// Adding a decoded record to a job's buffer
+static int      _bufferRecord(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Decoding the records of a job that start between off and job->to
+static void     _decodeChunk(
+    struct _ingestJob *job,
+    size_t off);
+
+// Decoding a whole compressed file into a job
+static void     _decodeStream(
+    struct _ingestJob *job);
+
+// Decoding a job again into fresh counters, stopping on the duplicate left
+// records in, so only what a serial run reads before it is counted
+static void     _replayJob(
+    struct _ingestJob *job,
+    size_t left);
+
+// Finding the first offset in a job's range that starts a chain of records
+static size_t   _syncChunk(
+    const struct _ingestJob *job);
+
+// Checking if a plausible packet record header starts at off
+static bool     _plausibleRecord(
+    const struct span *file,
+    size_t off,
+    int swap,
+    size_t *next);
+
+// Splitting a mapped file into jobs, returns the new job count
+static size_t   _planFile(
+    struct _ingestJob **jobs,
+    size_t count,
+    const struct span *file,
+    unsigned int threads);
+
+// Adding one job for a file that has to be read as a stream, returns the new
+// job count
+static size_t   _planStream(
+    struct _ingestJob **jobs,
+    size_t count,
+    const char *path);
+
+// Adding a decoded record to the graph, ctx is the graph
+int
+ingestApply(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    double          start = statsNow();
+    int             err = 0;
+
+    switch (getZType(&rec->zHead))
+    {
+    case ZERGSTATUS:
+        err = graphAddStatus(ctx, rec->zHead, rec->payload.status);
+        break;
+    case ZERGGPS:
+        err = graphAddNode(ctx, rec->zHead, &rec->payload.gps);
+        break;
+    default:
+        break;
+    }
+    statsTime(STATS_BUILD, start);
+
+    return err;
+}
+
+// Adding decoded records to the graph in order, counting any that were
+// rejected. Returns 2 if it stopped on a duplicate and 0 otherwise, added
+// gets how many were handed to the graph, the duplicate included. The
+// duplicate itself isn't reported, the caller decodes up to it again with
+// ingestCountdown so it is counted the way a serial run counts it
+int
+ingestApplyBatch(
+    graph g,
+    struct zergRecord *recs,
+    size_t count,
+    size_t *added)
+{
+    double          start = statsNow();
+    int             errs[INGESTBLOCK];
+    size_t          done = 0;
+    int             err = 0;
+
+    // The graph says what happened to each record a block at a time
+    while (!err && done < count)
+    {
+        size_t          n = count - done;
+
+        n = n < INGESTBLOCK ? n : INGESTBLOCK;
+        err = graphAddBatch(g, recs + done, n, errs);
+        for (size_t i = 0; i < n; i++)
+        {
+            done++;
+            if (errs[i] == 2)
+            {
+                break;
+            }
+            ingestReport(errs[i]);
+        }
+    }
+    *added = done;
+    statsTime(STATS_BUILD, start);
+
+    return err;
+}
+
+// Standing in for the graph while a batch is decoded again, ctx points to
+// how many records are left before the duplicate, which returns 2
+int
+ingestCountdown(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    size_t         *left = ctx;
+
+    (void) rec;
+
+    return (*left)-- ? 0 : 2;
+}
+
+// Counting an error from adding a record, returns true if ingest must stop.
+// A duplicate is only counted and running out of memory isn't, whoever
+// called for the ingest says so
+bool
+ingestReport(
+    int err)
+{
+    // Checking if there were any errors in adding
+    if (err == INGESTMEMORY)
+    {
+        return true;
+    }
+    else if (err == 2)
+    {
+        statsDuplicate();
+        return true;
+    }
+    else if (err > 0)
+    {
+        diagReport(DIAG_PAYLOAD);
+    }
+
+    return false;
+}
+
+// Decoding every packet record that starts in the first limit bytes of a span
+int
+ingestRecords(
+    struct span *cursor,
+    size_t limit,
+    int swap,
+    ingestEmit emit,
+    void *ctx)
+{
+    struct span     packet;
+    struct pcapPacketH ppHeader;
+    const unsigned char *stop = cursor->data + limit;
+    int             err;
+
+    // Main reading loop, each record is cut out of the span in place
+    while (cursor->data < stop && setPacketHeadSpan(cursor, &ppHeader, swap))
+    {
+        statsRead(1, sizeof(ppHeader) + ppHeader.length);
+
+        // A record longer than any capture is skipped, as the stream does
+        if (ppHeader.length > STREAMRECORD - sizeof(ppHeader))
+        {
+            diagReport(DIAG_PACKETHEAD);
+            if (spanSkip(cursor, ppHeader.length))
+            {
+                spanSkip(cursor, cursor->length);
+            }
+            continue;
+        }
+
+        packet.data = cursor->data;
+        packet.length = ppHeader.length;
+        if (packet.length > cursor->length)
+        {
+            packet.length = cursor->length;
+        }
+        spanSkip(cursor, packet.length);
+
+        if ((err = ingestPacket(packet.data, packet.length, emit, ctx)))
+        {
+            return err;
+        }
+    }
+
+    return 0;
+}
+
+// Decoding one captured frame, returns 2 on a duplicate, INGESTMEMORY if the
+// emitter ran out of memory and 0 otherwise
+int
+ingestPacket(
+    const unsigned char *data,
+    size_t length,
+    ingestEmit emit,
+    void *ctx)
+{
+    struct zergPacket zPacket;
+    enum zergParseErr parseErr;
+
+    // Validating every layer in place
+    if ((parseErr = zergParse(data, length, &zPacket)))
+    {
+        diagReport(zergParseReason[parseErr]);
+        return 0;
+    }
+
+    return _emitPacket(&zPacket, emit, ctx);
+}
+
+// Decoding one Zerg header and payload as found in a UDP datagram, returns 2
+// on a duplicate, INGESTMEMORY if the emitter ran out of memory and 0
+// otherwise
+int
+ingestDatagram(
+    const unsigned char *data,
+    size_t length,
+    ingestEmit emit,
+    void *ctx)
+{
+    struct zergPacket zPacket;
+    enum zergParseErr parseErr;
+
+    if ((parseErr = zergParseDatagram(data, length, &zPacket)))
+    {
+        diagReport(zergParseReason[parseErr]);
+        return 0;
+    }
+
+    return _emitPacket(&zPacket, emit, ctx);
+}
+
+// Reading a pcap from a descriptor front to back, never seeking, and
+// decoding every record in it
+int
+ingestStream(
+    int fd,
+    ingestEmit emit,
+    void *ctx)
+{
+    struct pcapStream stream;
+    struct unpacker *unpack;
+    struct span     packet;
+    ssize_t         got = 0;
+    int             next = 0;
+    int             err = 0;
+
+    if (streamOpen(&stream, fd))
+    {
+        return INGESTMEMORY;
+    }
+
+    // Compressed captures are inflated on their own thread
+    if (unpackStream(&stream, &unpack))
+    {
+        streamClose(&stream);
+        return 1;
+    }
+
+    // Decoding each record as soon as all of it has been read
+    do
+    {
+        while (!err && (next = streamNext(&stream, &packet)) > 0)
+        {
+            err = ingestPacket(packet.data, packet.length, emit, ctx);
+        }
+        if (next < 0)
+        {
+            err = 1;
+        }
+    } while (!err && (got = streamFill(&stream)) > 0);
+
+    // A record cut short by the end is decoded as far as it goes
+    if (!err && got < 0)
+    {
+        fprintf(stderr, unpack ? "Unable to decompress the stream\n" :
+                "Unable to read the stream\n");
+        err = 1;
+    }
+    else if (!err && (next = streamLast(&stream, &packet)) < 0)
+    {
+        err = 1;
+    }
+    else if (!err && next)
+    {
+        err = ingestPacket(packet.data, packet.length, emit, ctx);
+    }
+
+    unpackStop(unpack);
+    streamClose(&stream);
+
+    return err;
+}
+
+// Reading a pcap file with stdio and decoding every record in it, a path of
+// INGESTSTDIN reads standard input as a stream
+int
+ingestStdio(
+    const char *path,
+    ingestEmit emit,
+    void *ctx)
+{
+    FILE           *fp;
+    struct pcapPacketH ppHeader;
+    struct zergRecord rec;
+    struct stat     info;
+    long int        size = LONG_MAX;
+    int             err = 0;
+    int             bad = 0;
+    int             swap = 0;
+    long int        dataLength = 0;
+    unsigned int    skipBytes = 0;
+    unsigned char   magic[UNPACKMAGIC];
+
+    // Pipes can't seek, so they are read as a stream
+    if (!strcmp(path, INGESTSTDIN))
+    {
+        return ingestStream(STDIN_FILENO, emit, ctx);
+    }
+
+    // Attempting to open the file given
+    fp = fopen(path, "r");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", path);
+        return 1;
+    }
+
+    // Compressed captures are inflated as a stream instead
+    if (fread(magic, sizeof(magic), 1, fp) == 1 &&
+        unpackDetect(magic, sizeof(magic)))
+    {
+        fclose(fp);
+        return _ingestPath(path, emit, ctx);
+    }
+    rewind(fp);
+
+    // Only a regular file's size says where it ends
+    if (!fstat(fileno(fp), &info) && S_ISREG(info.st_mode))
+    {
+        size = info.st_size;
+    }
+
+    // Reading the first header of the file
+    if (invalidPCAPHeader(fp, &swap))
+    {
+        return 1;
+    }
+    statsRead(0, PCAPFILELENGTH);
+
+    // Main reading loop
+    while (setPacketHead(fp, &ppHeader, swap))
+    {
+        skipBytes = ppHeader.length;
+        dataLength = ftell(fp);
+        statsRead(1, sizeof(ppHeader) + ppHeader.length);
+
+        // Records too long for any capture or cut short by the end of the
+        // file are handled the same as the mapped and stream readers
+        if (ppHeader.length > STREAMRECORD - sizeof(ppHeader))
+        {
+            diagReport(DIAG_PACKETHEAD);
+            if (ppHeader.length > size - dataLength)
+            {
+                break;
+            }
+            if (fseek(fp, ppHeader.length, SEEK_CUR))
+            {
+                fprintf(stderr, "Read Error Occurred\n");
+                fclose(fp);
+                return 1;
+            }
+            continue;
+        }
+        if (ppHeader.length > size - dataLength)
+        {
+            err = _ingestTail(fp, size - dataLength, emit, ctx);
+            fclose(fp);
+            return err;
+        }
+
+        // Validating the Ethernet, IP, UDP and Zerg headers
+        if ((bad = invalidEthOrIp(fp, ppHeader.length, &skipBytes)) ||
+            (bad = invalidZergHeader(fp, &rec.zHead, &skipBytes)))
+        {
+            if (bad < 0)
+            {
+                fclose(fp);
+                return 1;
+            }
+            continue;
+        }
+
+        // Handing the correct payload on
+        err = 0;
+        statsPayload(getZType(&rec.zHead));
+        switch (getZType(&rec.zHead))
+        {
+        case ZERGSTATUS:
+            err = setZStatus(fp, &rec.payload.status,
+                             sizeof(rec.payload.status)) ? 1 : emit(ctx, &rec);
+            break;
+        case ZERGGPS:
+            err = setZGPS(fp, &rec.payload.gps, sizeof(rec.payload.gps)) ? 1 :
+                emit(ctx, &rec);
+            break;
+
+        default:
+            diagReport(DIAG_PAYLOADTYPE);
+        }
+
+        // Stopping on duplicates, other errors only skip the packet
+        if (ingestReport(err))
+        {
+            fclose(fp);
+            return err;
+        }
+
+        // Reading any extra data
+        dataLength = (ftell(fp) - dataLength);
+        if (dataLength != ppHeader.length &&
+            skipAhead(fp, DIAG_NONE, (ppHeader.length - dataLength)))
+        {
+            fclose(fp);
+            return 1;
+        }
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+// Mapping a pcap file and decoding every record in it, a path of
+// INGESTSTDIN reads standard input as a stream
+int
+ingestFile(
+    const char *path,
+    ingestEmit emit,
+    void *ctx)
+{
+    struct span     file;
+    struct span     cursor;
+    int             swap = 0;
+    int             err = 0;
+
+    if (!strcmp(path, INGESTSTDIN))
+    {
+        return ingestStream(STDIN_FILENO, emit, ctx);
+    }
+
+    // Attempting to map the file given
+    if (pcapMapOpen(path, &file))
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", path);
+        return 1;
+    }
+    if (unpackDetect(file.data, file.length))
+    {
+        pcapMapClose(&file);
+        return _ingestPath(path, emit, ctx);
+    }
+    cursor = file;
+
+    // Reading the first header of the file
+    if (invalidPCAPHeaderSpan(&cursor, &swap, stderr))
+    {
+        pcapMapClose(&file);
+        return 1;
+    }
+    statsRead(0, PCAPFILELENGTH);
+
+    err = ingestRecords(&cursor, cursor.length, swap, emit, ctx);
+
+    pcapMapClose(&file);
+
+    return err;
+}
+
+// Decoding files on worker threads and adding them to the graph in order
+int
+ingestFiles(
+    graph g,
+    char *paths[],
+    size_t count,
+    unsigned int threads)
+{
+    struct _ingestPool pool = { 0 };
+    struct span    *files = calloc(count, sizeof(*files));
+    pthread_t      *workers = calloc(threads, sizeof(*workers));
+    unsigned int    started = 0;
+    size_t          prevNext = 0;
+    size_t          planned = count;
+    size_t          added;
+    int             err = 0;
+
+    if (!files || !workers)
+    {
+        free(files);
+        free(workers);
+        return INGESTMEMORY;
+    }
+
+    // Mapping every file and splitting large ones into chunks, the first
+    // one that can't be is left for later so nothing is printed early
+    for (size_t i = 0; i < count; i++)
+    {
+        struct span     cursor;
+        int             swap = 0;
+        size_t          jobs;
+
+        if (pcapMapOpen(paths[i], &files[i]))
+        {
+            planned = i;
+            break;
+        }
+
+        // Compressed files can't be split, one worker inflates each
+        if (unpackDetect(files[i].data, files[i].length))
+        {
+            pcapMapClose(&files[i]);
+            jobs = _planStream(&pool.jobs, pool.count, paths[i]);
+        }
+        else
+        {
+            cursor = files[i];
+            jobs = invalidPCAPHeaderSpan(&cursor, &swap, NULL) ? pool.count :
+                _planFile(&pool.jobs, pool.count, &files[i], threads);
+        }
+
+        if (jobs == pool.count)
+        {
+            pcapMapClose(&files[i]);
+            planned = i;
+            break;
+        }
+        for (size_t j = pool.count; j < jobs; j++)
+        {
+            pool.jobs[j].swap = swap;
+        }
+        pool.count = jobs;
+    }
+
+    // There's no use for more workers than chunks
+    if (threads > pool.count)
+    {
+        threads = pool.count;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.ready, NULL);
+
+    // Starting the workers
+    for (; started < threads; started++)
+    {
+        if (pthread_create(&workers[started], NULL, _ingestWorker, &pool))
+        {
+            break;
+        }
+    }
+
+    // Decoding on this thread if no workers could be started
+    if (!started)
+    {
+        _ingestWorker(&pool);
+    }
+
+    // Merging each chunk in order as soon as it is decoded
+    for (size_t i = 0; i < pool.count; i++)
+    {
+        struct _ingestJob *job = &pool.jobs[i];
+
+        pthread_mutex_lock(&pool.lock);
+        while (!job->done)
+        {
+            pthread_cond_wait(&pool.ready, &pool.lock);
+        }
+        pthread_mutex_unlock(&pool.lock);
+
+        // The first chunk of a file always starts right after the header,
+        // which a stream counts for itself
+        if (job->from == PCAPFILELENGTH)
+        {
+            prevNext = PCAPFILELENGTH;
+            if (!job->path)
+            {
+                statsRead(0, PCAPFILELENGTH);
+            }
+        }
+
+        // Redoing a chunk that synced somewhere the previous one didn't end
+        if (job->start != prevNext)
+        {
+            job->count = 0;
+            _decodeChunk(job, prevNext);
+        }
+        prevNext = job->next;
+
+        // Only what a serial run reads before a duplicate is counted
+        err = ingestApplyBatch(g, job->records, job->count, &added);
+        if (err)
+        {
+            _replayJob(job, added - 1);
+        }
+        statsMerge(&job->counters);
+        diagMerge(&job->diag);
+
+        // A chunk that ran out of memory, or a compressed file that couldn't
+        // be read, stops here like a serial run
+        if (!err)
+        {
+            err = job->err;
+        }
+
+        free(job->records);
+        job->records = NULL;
+        if (err)
+        {
+            break;
+        }
+    }
+
+    // Files from one that couldn't be planned on are read serially, once
+    // everything before them made it in, so any error is printed in order
+    for (size_t i = planned; i < count && !err; i++)
+    {
+        err = ingestFile(paths[i], ingestApply, g);
+    }
+
+    // Letting the workers skip any chunks that are left
+    pthread_mutex_lock(&pool.lock);
+    pool.stop = true;
+    pthread_mutex_unlock(&pool.lock);
+
+    for (unsigned int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i], NULL);
+    }
+
+    for (size_t i = 0; i < pool.count; i++)
+    {
+        free(pool.jobs[i].records);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        pcapMapClose(&files[i]);
+    }
+    pthread_cond_destroy(&pool.ready);
+    pthread_mutex_destroy(&pool.lock);
+    free(pool.jobs);
+    free(workers);
+    free(files);
+
+    return err;
+}
+
+// Decoding chunks until there are none left
+static void    *
+_ingestWorker(
+    void *arg)
+{
+    struct _ingestPool *pool = arg;
+    struct _ingestJob *job;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->stop || pool->next >= pool->count)
+        {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        job = &pool->jobs[pool->next++];
+        pthread_mutex_unlock(&pool->lock);
+
+        // Chunks in the middle of a file have to find a record boundary
+        if (job->path)
+        {
+            _decodeStream(job);
+        }
+        else if (job->from == PCAPFILELENGTH)
+        {
+            _decodeChunk(job, job->from);
+        }
+        else
+        {
+            _decodeChunk(job, _syncChunk(job));
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        job->done = true;
+        pthread_cond_broadcast(&pool->ready);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Decoding the records of a job that start between off and job->to
+static void
+_decodeChunk(
+    struct _ingestJob *job,
+    size_t off)
+{
+    struct span     cursor;
+
+    job->start = off;
+    job->next = off;
+    job->err = 0;
+    memset(&job->counters, 0, sizeof(job->counters));
+    memset(&job->diag, 0, sizeof(job->diag));
+    if (off >= job->to)
+    {
+        return;
+    }
+
+    // Counting into the job so a chunk that is redone isn't counted twice
+    cursor.data = job->file->data + off;
+    cursor.length = job->file->length - off;
+    statsUse(&job->counters);
+    diagUse(&job->diag);
+    job->err = ingestRecords(&cursor, job->to - off, job->swap, _bufferRecord,
+                             job);
+    diagUse(NULL);
+    statsUse(NULL);
+    job->next = cursor.data - job->file->data;
+}
+
+// Decoding a whole compressed file into a job
+static void
+_decodeStream(
+    struct _ingestJob *job)
+{
+    job->start = PCAPFILELENGTH;
+    job->next = PCAPFILELENGTH;
+    memset(&job->counters, 0, sizeof(job->counters));
+    memset(&job->diag, 0, sizeof(job->diag));
+
+    statsUse(&job->counters);
+    diagUse(&job->diag);
+    job->err = _ingestPath(job->path, _bufferRecord, job);
+    diagUse(NULL);
+    statsUse(NULL);
+}
+
+// Decoding a job again into fresh counters, stopping on the duplicate left
+// records in, so only what a serial run reads before it is counted
+static void
+_replayJob(
+    struct _ingestJob *job,
+    size_t left)
+{
+    struct span     cursor;
+
+    memset(&job->counters, 0, sizeof(job->counters));
+    memset(&job->diag, 0, sizeof(job->diag));
+    statsUse(&job->counters);
+    diagUse(&job->diag);
+    if (job->path)
+    {
+        _ingestPath(job->path, ingestCountdown, &left);
+    }
+    else
+    {
+        cursor.data = job->file->data + job->start;
+        cursor.length = job->file->length - job->start;
+        ingestRecords(&cursor, job->to - job->start, job->swap,
+                      ingestCountdown, &left);
+    }
+    diagUse(NULL);
+    statsUse(NULL);
+}
+
+// Finding the first offset in a job's range that starts a chain of records
+static size_t
+_syncChunk(
+    const struct _ingestJob *job)
+{
+    for (size_t off = job->from; off < job->to; off++)
+    {
+        size_t          cur = off;
+        int             chain = 0;
+
+        // A boundary needs several records in a row or a clean end of file
+        while (chain < CHUNKCHAIN &&
+               _plausibleRecord(job->file, cur, job->swap, &cur))
+        {
+            chain++;
+            if (cur == job->file->length)
+            {
+                chain = CHUNKCHAIN;
+            }
+        }
+
+        if (chain == CHUNKCHAIN)
+        {
+            return off;
+        }
+    }
+
+    return job->to;
+}
+
+// Checking if a plausible packet record header starts at off
+static bool
+_plausibleRecord(
+    const struct span *file,
+    size_t off,
+    int swap,
+    size_t *next)
+{
+    struct pcapPacketH ppHeader;
+
+    if (file->length - off < sizeof(ppHeader))
+    {
+        return false;
+    }
+    memcpy(&ppHeader, file->data + off, sizeof(ppHeader));
+    if (swap)
+    {
+        ppHeader.microEpoch = u32BitSwap(ppHeader.microEpoch);
+        ppHeader.length = u32BitSwap(ppHeader.length);
+        ppHeader.untrunLength = u32BitSwap(ppHeader.untrunLength);
+    }
+
+    // Checking the lengths and timestamp fields are sane
+    if (ppHeader.length == 0 || ppHeader.length > PCAPMAXSNAP ||
+        ppHeader.microEpoch >= 1000000 ||
+        ppHeader.untrunLength > PCAPMAXSNAP ||
+        (ppHeader.untrunLength && ppHeader.untrunLength < ppHeader.length) ||
+        file->length - off - sizeof(ppHeader) < ppHeader.length)
+    {
+        return false;
+    }
+
+    *next = off + sizeof(ppHeader) + ppHeader.length;
+
+    return true;
+}
+
+// Splitting a mapped file into jobs, returns the new job count
+static size_t
+_planFile(
+    struct _ingestJob **jobs,
+    size_t count,
+    const struct span *file,
+    unsigned int threads)
+{
+    size_t          body = file->length - PCAPFILELENGTH;
+    size_t          chunks = body / CHUNKMIN;
+    struct _ingestJob *grown;
+
+    if (chunks > threads)
+    {
+        chunks = threads;
+    }
+    if (chunks == 0)
+    {
+        chunks = 1;
+    }
+
+    grown = realloc(*jobs, (count + chunks) * sizeof(*grown));
+    if (!grown)
+    {
+        return count;
+    }
+    *jobs = grown;
+
+    // Evenly sized byte ranges, the last one runs to the end of the file
+    for (size_t c = 0; c < chunks; c++)
+    {
+        struct _ingestJob *job = &grown[count + c];
+
+        memset(job, 0, sizeof(*job));
+        job->file = file;
+        job->from = PCAPFILELENGTH + body / chunks * c;
+        job->to = PCAPFILELENGTH + body / chunks * (c + 1);
+        if (c == chunks - 1)
+        {
+            job->to = file->length;
+        }
+    }
+
+    return count + chunks;
+}
+
+// Adding one job for a file that has to be read as a stream, returns the new
+// job count
+static size_t
+_planStream(
+    struct _ingestJob **jobs,
+    size_t count,
+    const char *path)
+{
+    struct _ingestJob *grown = realloc(*jobs, (count + 1) * sizeof(*grown));
+
+    if (!grown)
+    {
+        return count;
+    }
+    *jobs = grown;
+
+    memset(&grown[count], 0, sizeof(*grown));
+    grown[count].path = path;
+    grown[count].from = PCAPFILELENGTH;
+
+    return count + 1;
+}
+
+// Decoding the last length bytes of a file read with stdio, for a record the
+// file ended partway through, returns 2 on a duplicate, 1 on a read error and
+// INGESTMEMORY if it ran out of memory
+static int
+_ingestTail(
+    FILE * fp,
+    size_t length,
+    ingestEmit emit,
+    void *ctx)
+{
+    unsigned char  *data = malloc(length ? length : 1);
+    int             err;
+
+    if (!data)
+    {
+        return INGESTMEMORY;
+    }
+    if (fread(data, 1, length, fp) != length)
+    {
+        fprintf(stderr, "Read Error Occurred\n");
+        free(data);
+        return 1;
+    }
+
+    err = ingestPacket(data, length, emit, ctx);
+    free(data);
+
+    return err;
+}
+
+// Opening a file and decoding it as a stream
+static int
+_ingestPath(
+    const char *path,
+    ingestEmit emit,
+    void *ctx)
+{
+    int             fd = open(path, O_RDONLY);
+    int             err;
+
+    if (fd < 0)
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", path);
+        return 1;
+    }
+
+    err = ingestStream(fd, emit, ctx);
+    close(fd);
+
+    return err;
+}
+
+// Decoding the payload of a validated packet and handing it on
+static int
+_emitPacket(
+    const struct zergPacket *pkt,
+    ingestEmit emit,
+    void *ctx)
+{
+    struct zergRecord rec;
+    int             err = 0;
+
+    zergParseHeader(pkt, &rec.zHead);
+    statsPayload(getZType(&rec.zHead));
+
+    // Decoding the correct payload
+    switch (getZType(&rec.zHead))
+    {
+    case ZERGSTATUS:
+        err = zergParseStatus(pkt, &rec.payload.status) ? 1 : emit(ctx, &rec);
+        break;
+    case ZERGGPS:
+        err = zergParseGPS(pkt, &rec.payload.gps) ? 1 : emit(ctx, &rec);
+        break;
+
+    default:
+        diagReport(DIAG_PAYLOADTYPE);
+    }
+
+    return ingestReport(err) ? err : 0;
+}
+
+// Adding a decoded record to a job's buffer
+static int
+_bufferRecord(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    struct _ingestJob *job = ctx;
+
+    // Growing the buffer when it's full
+    if (job->count == job->capacity)
+    {
+        size_t          capacity = job->capacity ? job->capacity * 2 : 256;
+        struct zergRecord *records =
+            realloc(job->records, capacity * sizeof(*records));
+
+        if (!records)
+        {
+            return INGESTMEMORY;
+        }
+        job->records = records;
+        job->capacity = capacity;
+    }
+
+    job->records[job->count++] = *rec;
+
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*  zergIngest.h  */
+
+#ifndef ZERGINGEST_H
+#define ZERGINGEST_H
+
+#include <stddef.h>
+
+#include "zergHeaders.h"
+#include "graph.h"
+
+#define INGESTSTDIN "-"
+
+// Returned by an emitter that ran out of memory, and passed on by every
+// ingest function so it stops instead of dropping the record
+#define INGESTMEMORY 3
+
+struct span;
+
+// Called for every decoded record, returns the same codes as graphAddNode
+typedef int     (*ingestEmit) (void *ctx, struct zergRecord *rec);
+
+// Adding a decoded record to the graph, ctx is the graph
+int             ingestApply(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Adding decoded records to the graph in order, counting any that were
+// rejected. Returns 2 if it stopped on a duplicate and 0 otherwise, added
+// gets how many were handed to the graph, the duplicate included. The
+// duplicate itself isn't reported, the caller decodes up to it again with
+// ingestCountdown so it is counted the way a serial run counts it
+int             ingestApplyBatch(
+    graph g,
+    struct zergRecord *recs,
+    size_t count,
+    size_t *added);
+
+// Standing in for the graph while a batch is decoded again, ctx points to
+// how many records are left before the duplicate, which returns 2
+int             ingestCountdown(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Counting an error from adding a record, returns true if ingest must stop.
+// A duplicate is only counted and running out of memory isn't, whoever
+// called for the ingest says so
+bool            ingestReport(
+    int err);
+
+// Decoding every packet record that starts in the first limit bytes of a span
+int             ingestRecords(
+    struct span *cursor,
+    size_t limit,
+    int swap,
+    ingestEmit emit,
+    void *ctx);
+
+// Decoding one captured frame, returns 2 on a duplicate, INGESTMEMORY if the
+// emitter ran out of memory and 0 otherwise
+int             ingestPacket(
+    const unsigned char *data,
+    size_t length,
+    ingestEmit emit,
+    void *ctx);
+
+// Decoding one Zerg header and payload as found in a UDP datagram, returns 2
+// on a duplicate, INGESTMEMORY if the emitter ran out of memory and 0
+// otherwise
+int             ingestDatagram(
+    const unsigned char *data,
+    size_t length,
+    ingestEmit emit,
+    void *ctx);
+
+// Reading a pcap from a descriptor front to back, never seeking, and
+// decoding every record in it
+int             ingestStream(
+    int fd,
+    ingestEmit emit,
+    void *ctx);
+
+// Reading a pcap file with stdio and decoding every record in it, a path of
+// INGESTSTDIN reads standard input as a stream
+int             ingestStdio(
+    const char *path,
+    ingestEmit emit,
+    void *ctx);
+
+// Mapping a pcap file and decoding every record in it, a path of
+// INGESTSTDIN reads standard input as a stream
+int             ingestFile(
+    const char *path,
+    ingestEmit emit,
+    void *ctx);
+
+// Decoding files, and large files in chunks, on worker threads and adding
+// them to the graph in order
+int             ingestFiles(
+    graph g,
+    char *paths[],
+    size_t count,
+    unsigned int threads);
+
+#endif
@@ -0,0 +1,287 @@
+/*  zergParse.c  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "zergHeaders.h"
+#include "netHeaders.h"
+#include "util.h"
+#include "zergParse.h"
+
+#define MINPCAPLENGTH 54
+#define ETHLENGTH 14
+#define VLANLENGTH 4
+#define IPV4LENGTH 20
+#define IPV6LENGTH 40
+#define UDPLENGTH 8
+#define ZERGLENGTH 12
+#define GPSLENGTH 32
+#define STATUSLENGTH 12
+
+// Messages for each of the parse errors
+const enum diagReason zergParseReason[ZPARSE_TOTAL] = {
+    DIAG_NONE,
+    DIAG_PACKETHEAD,
+    DIAG_ETHTYPE,
+    DIAG_IPV4,
+    DIAG_IPLENGTH,
+    DIAG_TRANSPORT,
+    DIAG_PORT,
+    DIAG_VERSION
+};
+
+// Reading big endian values straight out of the buffer
+static unsigned int _be16(
+    const unsigned char *p);
+static unsigned int _be24(
+    const unsigned char *p);
+static uint32_t _be32(
+    const unsigned char *p);
+static uint64_t _be64(
+    const unsigned char *p);
+
+// Validating an IPv6 header in place and moving past it
+static enum zergParseErr _parseIPv6(
+    const unsigned char **cur,
+    const unsigned char *end,
+    struct zergPacket *pkt);
+
+// Validating every layer of a packet record in place
+enum zergParseErr
+zergParse(
+    const unsigned char *data,
+    size_t length,
+    struct zergPacket *pkt)
+{
+    const unsigned char *end = data + length;
+    const unsigned char *cur = data;
+    enum zergParseErr err;
+
+    memset(pkt, 0, sizeof(*pkt));
+
+    // Checking if packet is of a valid length
+    if (length < MINPCAPLENGTH)
+    {
+        return ZPARSE_LENGTH;
+    }
+
+    // Ethernet, stepping over a 802.1Q tag or a QinQ pair of tags
+    pkt->eth = cur;
+    pkt->ethType = _be16(cur + ETHLENGTH - 2);
+    cur += ETHLENGTH;
+    if (pkt->ethType == ETH8021Q || pkt->ethType == ETH8021Q4)
+    {
+        unsigned int    outer = pkt->ethType;
+
+        pkt->ethType = _be16(cur + 2);
+        pkt->vlanTags++;
+        cur += VLANLENGTH;
+        if (outer == ETH8021Q4 && pkt->ethType == ETH8021Q)
+        {
+            pkt->ethType = _be16(cur + 2);
+            pkt->vlanTags++;
+            cur += VLANLENGTH;
+        }
+    }
+
+    // Network layer
+    if (pkt->ethType == ETHIPV4)
+    {
+        if (end - cur < IPV4LENGTH || (cur[0] >> 4) != IPV4 ||
+            (cur[0] & 0xf) < IHLDEFAULT || (cur[9] != UDP &&
+                                            cur[9] != IP6INIP4))
+        {
+            return ZPARSE_IPV4;
+        }
+        pkt->ipv4 = cur;
+
+        // Moving past any options
+        if (length < MINPCAPLENGTH + ((cur[0] & 0xfu) - IHLDEFAULT) * 4)
+        {
+            return ZPARSE_IPLENGTH;
+        }
+        cur += (cur[0] & 0xf) * 4;
+
+        // Checking for 6in4
+        if (pkt->ipv4[9] == IP6INIP4 &&
+            (err = _parseIPv6(&cur, end, pkt)) != ZPARSE_OK)
+        {
+            return err;
+        }
+    }
+    else if (pkt->ethType == ETHIPV6)
+    {
+        if ((err = _parseIPv6(&cur, end, pkt)) != ZPARSE_OK)
+        {
+            return err;
+        }
+    }
+    else
+    {
+        return ZPARSE_ETHTYPE;
+    }
+
+    // UDP
+    if (end - cur < UDPLENGTH || _be16(cur + 2) != ZERGPORT)
+    {
+        return ZPARSE_PORT;
+    }
+    pkt->udp = cur;
+    cur += UDPLENGTH;
+
+    return zergParseDatagram(cur, end - cur, pkt);
+}
+
+// Validating a Zerg header and payload in place, as found in a UDP datagram
+enum zergParseErr
+zergParseDatagram(
+    const unsigned char *data,
+    size_t length,
+    struct zergPacket *pkt)
+{
+    if (length < ZERGLENGTH || (data[0] >> 4) != 1)
+    {
+        return ZPARSE_VERSION;
+    }
+
+    pkt->zerg = data;
+    pkt->payload = data + ZERGLENGTH;
+    pkt->payloadLength = length - ZERGLENGTH;
+
+    return ZPARSE_OK;
+}
+
+// Returning the Zerg payload type
+unsigned int
+zergParseType(
+    const struct zergPacket *pkt)
+{
+    return pkt->zerg[0] & 0xf;
+}
+
+// Returning the Zerg source id
+unsigned int
+zergParseSource(
+    const struct zergPacket *pkt)
+{
+    return _be16(pkt->zerg + 4);
+}
+
+// Decoding the Zerg header into host order
+void
+zergParseHeader(
+    const struct zergPacket *pkt,
+    union zergH *zHead)
+{
+    zHead->details.type = pkt->zerg[0] & 0xf;
+    zHead->details.version = pkt->zerg[0] >> 4;
+    zHead->details.length = _be24(pkt->zerg + 1);
+    zHead->details.source = _be16(pkt->zerg + 4);
+    zHead->details.destination = _be16(pkt->zerg + 6);
+    zHead->details.sequence = _be32(pkt->zerg + 8);
+}
+
+// Decoding a GPS payload, returns true if the payload is too short
+bool
+zergParseGPS(
+    const struct zergPacket *pkt,
+    struct gpsH *gps)
+{
+    const unsigned char *p = pkt->payload;
+    uint64_t        d;
+    uint32_t        f;
+
+    if (pkt->payloadLength < GPSLENGTH)
+    {
+        return true;
+    }
+
+    d = _be64(p);
+    memcpy(&gps->longitude, &d, sizeof(d));
+    d = _be64(p + 8);
+    memcpy(&gps->latitude, &d, sizeof(d));
+    f = _be32(p + 16);
+    memcpy(&gps->altitude, &f, sizeof(f));
+    f = _be32(p + 20);
+    memcpy(&gps->bearing, &f, sizeof(f));
+    f = _be32(p + 24);
+    memcpy(&gps->speed, &f, sizeof(f));
+    f = _be32(p + 28);
+    memcpy(&gps->accuracy, &f, sizeof(f));
+
+    return false;
+}
+
+// Decoding a Status payload, returns true if the payload is too short
+bool
+zergParseStatus(
+    const struct zergPacket *pkt,
+    struct statusH *status)
+{
+    const unsigned char *p = pkt->payload;
+    uint32_t        f;
+
+    if (pkt->payloadLength < STATUSLENGTH)
+    {
+        return true;
+    }
+
+    // Armor is nibble swapped to match setZStatus
+    status->hp = _be24(p);
+    status->armor = u8BitSwap(p[3]);
+    status->maxHp = _be24(p + 4);
+    status->type = p[7];
+    f = _be32(p + 8);
+    memcpy(&status->speed, &f, sizeof(f));
+
+    return false;
+}
+
+// Validating an IPv6 header in place and moving past it
+static enum zergParseErr
+_parseIPv6(
+    const unsigned char **cur,
+    const unsigned char *end,
+    struct zergPacket *pkt)
+{
+    if (end - *cur < IPV6LENGTH || (*cur)[6] != UDP)
+    {
+        return ZPARSE_IPV6;
+    }
+
+    pkt->ipv6 = *cur;
+    (*cur) += IPV6LENGTH;
+
+    return ZPARSE_OK;
+}
+
+// Reading big endian values straight out of the buffer
+static unsigned int
+_be16(
+    const unsigned char *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+static unsigned int
+_be24(
+    const unsigned char *p)
+{
+    return (p[0] << 16) | (p[1] << 8) | p[2];
+}
+
+static uint32_t
+_be32(
+    const unsigned char *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+        ((uint32_t) p[2] << 8) | p[3];
+}
+
+static uint64_t
+_be64(
+    const unsigned char *p)
+{
+    return ((uint64_t) _be32(p) << 32) | _be32(p + 4);
+}
@@ -0,0 +1,78 @@
+/*  zergParse.h  */
+
+#ifndef ZERGPARSE_H
+#define ZERGPARSE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "zergHeaders.h"
+#include "zergDiag.h"
+
+// Reasons a packet can be rejected by zergParse
+enum zergParseErr
+{
+    ZPARSE_OK = 0,
+    ZPARSE_LENGTH,
+    ZPARSE_ETHTYPE,
+    ZPARSE_IPV4,
+    ZPARSE_IPLENGTH,
+    ZPARSE_IPV6,
+    ZPARSE_PORT,
+    ZPARSE_VERSION,
+    ZPARSE_TOTAL
+};
+
+// Diagnostic reasons for each of the parse errors
+extern const enum diagReason zergParseReason[ZPARSE_TOTAL];
+
+// Pointers to each layer of a packet, all pointing into the caller's buffer
+struct zergPacket
+{
+    const unsigned char *eth;
+    const unsigned char *ipv4;
+    const unsigned char *ipv6;
+    const unsigned char *udp;
+    const unsigned char *zerg;
+    const unsigned char *payload;
+    size_t          payloadLength;
+    unsigned int    ethType;
+    unsigned int    vlanTags;
+};
+
+// Validating every layer of a packet record in place
+enum zergParseErr zergParse(
+    const unsigned char *data,
+    size_t length,
+    struct zergPacket *pkt);
+
+// Validating a Zerg header and payload in place, as found in a UDP datagram
+enum zergParseErr zergParseDatagram(
+    const unsigned char *data,
+    size_t length,
+    struct zergPacket *pkt);
+
+// Returning the Zerg payload type
+unsigned int    zergParseType(
+    const struct zergPacket *pkt);
+
+// Returning the Zerg source id
+unsigned int    zergParseSource(
+    const struct zergPacket *pkt);
+
+// Decoding the Zerg header into host order
+void            zergParseHeader(
+    const struct zergPacket *pkt,
+    union zergH *zHead);
+
+// Decoding a GPS payload, returns true if the payload is too short
+bool            zergParseGPS(
+    const struct zergPacket *pkt,
+    struct gpsH *gps);
+
+// Decoding a Status payload, returns true if the payload is too short
+bool            zergParseStatus(
+    const struct zergPacket *pkt,
+    struct statusH *status);
+
+#endif
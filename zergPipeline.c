@@ -0,0 +1,710 @@
+/*  zergPipeline.c  */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "zergHeaders.h"
+#include "util.h"
+#include "graph.h"
+#include "zergStats.h"
+#include "zergDiag.h"
+#include "zergIngest.h"
+#include "pcapStream.h"
+#include "pcapUnpack.h"
+#include "ring.h"
+#include "zergPipeline.h"
+
+#define PIPERAW (1 << 18)
+#define PIPERECORDS 2048
+#define PIPEDEPTH 4
+#define PIPESPINS 64
+
+// What the reader had counted once a record was read
+struct _pipeMark
+{
+    size_t          packets;
+    size_t          bytes;
+    size_t          skipped;
+} _pipeMark;
+
+// Packet records copied out of the capture and what they decoded to
+struct _pipeBatch
+{
+    unsigned char  *raw;
+    size_t          size;
+    size_t          used;
+    size_t         *lengths;
+    struct _pipeMark *marks;
+    size_t          packets;
+    struct zergRecord *records;
+    size_t          count;
+    struct statsCounters counters;
+    struct diagCounters diag;
+} _pipeBatch;
+
+// Everything the stages share, batch k is decoded by decoder k % decoders
+struct _pipeline
+{
+    struct ring     free;
+    struct ring    *toDecode;
+    struct ring    *decoded;
+    unsigned int    decoders;
+    struct _pipeBatch *batches;
+    size_t          count;
+    struct pcapStream stream;
+    struct unpacker *unpack;
+    struct statsCounters readCounters;
+    struct diagCounters readDiag;
+    struct _pipeMark merged;
+    size_t          produced;
+    atomic_bool     readDone;
+    atomic_bool     stop;
+    int             readErr;
+    atomic_size_t   progress;
+    atomic_uint     sleepers;
+    pthread_mutex_t lock;
+    pthread_cond_t  wake;
+} _pipeline;
+
+// The pipeline and which rings a decoder thread works between
+struct _pipeWorker
+{
+    struct _pipeline *p;
+    unsigned int    index;
+    pthread_t       thread;
+} _pipeWorker;
+
+// How long one stage has been waiting on another
+struct _pipeIdle
+{
+    unsigned int    spins;
+    size_t          seen;
+};
+
+// Setting up the rings and batches, returns true if they couldn't be made
+static bool     _pipeCreate(
+    struct _pipeline *p,
+    unsigned int decoders);
+
+// Freeing the rings and batches
+static void     _pipeDestroy(
+    struct _pipeline *p);
+
+// Reading records into batches and handing them out in turn
+static void    *_readStage(
+    void *arg);
+
+// Decoding every batch handed to one decoder
+static void    *_decodeStage(
+    void *arg);
+
+// Adding the records of each batch to the graph in the order they were read,
+// returns the same codes as ingestStdio
+static int      _graphStage(
+    struct _pipeline *p,
+    graph g);
+
+// Waiting for a free batch and counting into it, returns NULL once stopped
+static struct _pipeBatch *_pipeTake(
+    struct _pipeline *p);
+
+// Handing batch k to its decoder, returns true if stopped first
+static bool     _pipeSend(
+    struct _pipeline *p,
+    struct _pipeBatch *batch,
+    size_t k);
+
+// Copying a record into the batch, sending the batch on first if it is full.
+// Returns the batch to keep filling, NULL once stopped
+static struct _pipeBatch *_pipeAdd(
+    struct _pipeline *p,
+    struct _pipeBatch *batch,
+    const struct span *packet,
+    size_t *k);
+
+// Keeping a decoded record in its batch
+static int      _pipeRecord(
+    void *ctx,
+    struct zergRecord *rec);
+
+// Decoding a batch again into fresh counters, stopping on the duplicate left
+// records in, returns the packet it was found in
+static size_t   _pipeReplay(
+    struct _pipeBatch *batch,
+    size_t left);
+
+// Adding what the reader counted up to a mark into the totals
+static void     _pipeMergeRead(
+    struct _pipeline *p,
+    const struct _pipeMark *mark);
+
+// Waiting while another stage catches up, yielding for the first few looks
+// and then sleeping until some stage moves a batch
+static void     _pipeWait(
+    struct _pipeline *p,
+    struct _pipeIdle *idle);
+
+// Telling any sleeping stage that a batch moved or the pipeline stopped
+static void     _pipeWake(
+    struct _pipeline *p);
+
+/*
+ * Each pair of stages is joined by single producer, single consumer rings.
+ * The reader hands batches to the decoders round robin and the graph stage
+ * takes them back in the same rotation, so records reach the graph in the
+ * order they were read no matter which decoder finishes first. Emptied
+ * batches go back to the reader through one more ring, so nothing is
+ * allocated once the pipeline is running, apart from growing a batch for a
+ * record bigger than it. The reader keeps its own running counts and marks
+ * them at every record, so a duplicate only adds in what a serial run would
+ * have read before stopping on it. A stage with nothing to do yields a few
+ * times and then sleeps, and every ring operation bumps a progress count
+ * that wakes it, so a stalled reader doesn't cost every core.
+ */
+
+// Reading, decoding and adding a pcap to the graph as three overlapping
+// stages, returns the same codes as ingestStdio
+int
+pipelineIngest(
+    graph g,
+    const char *path,
+    unsigned int decoders)
+{
+    struct _pipeline p;
+    struct _pipeWorker *workers;
+    pthread_t       reader;
+    unsigned int    started = 0;
+    int             fd = STDIN_FILENO;
+    int             err = 0;
+
+    if (strcmp(path, INGESTSTDIN) && (fd = open(path, O_RDONLY)) < 0)
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", path);
+        return 1;
+    }
+
+    workers = calloc(decoders, sizeof(*workers));
+    if (_pipeCreate(&p, decoders) || !workers || streamOpen(&p.stream, fd))
+    {
+        free(workers);
+        _pipeDestroy(&p);
+        if (fd != STDIN_FILENO)
+        {
+            close(fd);
+        }
+        return INGESTMEMORY;
+    }
+
+    // Compressed captures get a fourth stage in front of the reader
+    if (unpackStream(&p.stream, &p.unpack))
+    {
+        err = 1;
+    }
+    else if (pthread_create(&reader, NULL, _readStage, &p))
+    {
+        fprintf(stderr, "Unable to start the pipeline\n");
+        err = 1;
+    }
+
+    for (; !err && started < decoders; started++)
+    {
+        workers[started].p = &p;
+        workers[started].index = started;
+        if (pthread_create(&workers[started].thread, NULL, _decodeStage,
+                           &workers[started]))
+        {
+            break;
+        }
+    }
+
+    // Every batch has a decoder waiting for it or nothing can be run
+    if (!err && started < decoders)
+    {
+        fprintf(stderr, "Unable to start the pipeline\n");
+        atomic_store(&p.stop, true);
+        _pipeWake(&p);
+        pthread_join(reader, NULL);
+        err = 1;
+    }
+    else if (!err)
+    {
+        err = _graphStage(&p, g);
+
+        // Letting the other stages give up on anything left
+        atomic_store(&p.stop, true);
+        _pipeWake(&p);
+        pthread_join(reader, NULL);
+        if (!err)
+        {
+            err = p.readErr;
+        }
+    }
+
+    for (unsigned int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    unpackStop(p.unpack);
+    streamClose(&p.stream);
+    _pipeDestroy(&p);
+    free(workers);
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+
+    return err;
+}
+
+// Setting up the rings and batches, returns true if they couldn't be made
+static bool
+_pipeCreate(
+    struct _pipeline *p,
+    unsigned int decoders)
+{
+    bool            missing;
+
+    memset(p, 0, sizeof(*p));
+    atomic_init(&p->readDone, false);
+    atomic_init(&p->stop, false);
+    atomic_init(&p->progress, 0);
+    atomic_init(&p->sleepers, 0);
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->wake, NULL);
+    p->count = decoders * PIPEDEPTH;
+
+    // The rings are aligned so each index stays on its own cache line
+    p->toDecode = aligned_alloc(RINGLINE, decoders * sizeof(*p->toDecode));
+    p->decoded = aligned_alloc(RINGLINE, decoders * sizeof(*p->decoded));
+    p->batches = calloc(p->count, sizeof(*p->batches));
+    missing = !p->toDecode || !p->decoded || !p->batches ||
+        ringInit(&p->free, p->count);
+    if (missing)
+    {
+        return true;
+    }
+
+    // Only rings that have been cleared are ever freed
+    memset(p->toDecode, 0, decoders * sizeof(*p->toDecode));
+    memset(p->decoded, 0, decoders * sizeof(*p->decoded));
+    p->decoders = decoders;
+    for (unsigned int i = 0; i < decoders && !missing; i++)
+    {
+        missing = ringInit(&p->toDecode[i], PIPEDEPTH) ||
+            ringInit(&p->decoded[i], PIPEDEPTH);
+    }
+
+    for (size_t i = 0; i < p->count && !missing; i++)
+    {
+        struct _pipeBatch *batch = &p->batches[i];
+
+        batch->raw = malloc(PIPERAW);
+        batch->size = PIPERAW;
+        batch->lengths = malloc(PIPERECORDS * sizeof(*batch->lengths));
+        batch->marks = malloc(PIPERECORDS * sizeof(*batch->marks));
+        batch->records = malloc(PIPERECORDS * sizeof(*batch->records));
+        missing = !batch->raw || !batch->lengths || !batch->marks ||
+            !batch->records || ringPush(&p->free, batch);
+    }
+
+    return missing;
+}
+
+// Freeing the rings and batches
+static void
+_pipeDestroy(
+    struct _pipeline *p)
+{
+    for (size_t i = 0; p->batches && i < p->count; i++)
+    {
+        free(p->batches[i].raw);
+        free(p->batches[i].lengths);
+        free(p->batches[i].marks);
+        free(p->batches[i].records);
+    }
+    for (unsigned int i = 0; i < p->decoders; i++)
+    {
+        ringFree(&p->toDecode[i]);
+        ringFree(&p->decoded[i]);
+    }
+    ringFree(&p->free);
+    free(p->batches);
+    free(p->toDecode);
+    free(p->decoded);
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->lock);
+}
+
+// Reading records into batches and handing them out in turn
+static void    *
+_readStage(
+    void *arg)
+{
+    struct _pipeline *p = arg;
+    struct _pipeBatch *batch;
+    struct span     packet;
+    size_t          k = 0;
+    ssize_t         got;
+    int             next;
+
+    statsUse(&p->readCounters);
+    diagUse(&p->readDiag);
+    batch = _pipeTake(p);
+    while (batch)
+    {
+        if ((next = streamNext(&p->stream, &packet)) > 0)
+        {
+            batch = _pipeAdd(p, batch, &packet, &k);
+            continue;
+        }
+        if (next < 0)
+        {
+            p->readErr = 1;
+            break;
+        }
+        if ((got = streamFill(&p->stream)) > 0)
+        {
+            continue;
+        }
+
+        // A record cut short by the end is decoded as far as it goes
+        if (got < 0)
+        {
+            fprintf(stderr, p->unpack ? "Unable to decompress the stream\n" :
+                    "Unable to read the stream\n");
+            p->readErr = 1;
+        }
+        else if ((next = streamLast(&p->stream, &packet)) < 0)
+        {
+            p->readErr = 1;
+        }
+        else if (next)
+        {
+            batch = _pipeAdd(p, batch, &packet, &k);
+        }
+        break;
+    }
+
+    // What was read after the last record is added in once this is done
+    if (batch && batch->packets && !_pipeSend(p, batch, k))
+    {
+        k++;
+    }
+    diagUse(NULL);
+    statsUse(NULL);
+
+    p->produced = k;
+    atomic_store_explicit(&p->readDone, true, memory_order_release);
+    _pipeWake(p);
+
+    return NULL;
+}
+
+// Decoding every batch handed to one decoder
+static void    *
+_decodeStage(
+    void *arg)
+{
+    struct _pipeWorker *w = arg;
+    struct _pipeline *p = w->p;
+    struct ring    *in = &p->toDecode[w->index];
+    struct ring    *out = &p->decoded[w->index];
+    struct _pipeBatch *batch;
+    struct _pipeIdle idle = { 0, 0 };
+
+    while (!atomic_load_explicit(&p->stop, memory_order_relaxed))
+    {
+        // Once the reader is done, one last look finds anything it sent
+        if (!(batch = ringPop(in)))
+        {
+            if (atomic_load_explicit(&p->readDone, memory_order_acquire) &&
+                !(batch = ringPop(in)))
+            {
+                break;
+            }
+            if (!batch)
+            {
+                _pipeWait(p, &idle);
+                continue;
+            }
+        }
+        idle.spins = 0;
+        _pipeWake(p);
+
+        const unsigned char *data = batch->raw;
+
+        statsUse(&batch->counters);
+        diagUse(&batch->diag);
+        for (size_t i = 0; i < batch->packets; i++)
+        {
+            ingestPacket(data, batch->lengths[i], _pipeRecord, batch);
+            data += batch->lengths[i];
+        }
+        diagUse(NULL);
+        statsUse(NULL);
+
+        while (ringPush(out, batch))
+        {
+            if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+            {
+                return NULL;
+            }
+            _pipeWait(p, &idle);
+        }
+        idle.spins = 0;
+        _pipeWake(p);
+    }
+
+    return NULL;
+}
+
+// Adding the records of each batch to the graph in the order they were read,
+// returns the same codes as ingestStdio
+static int
+_graphStage(
+    struct _pipeline *p,
+    graph g)
+{
+    struct _pipeBatch *batch;
+    struct _pipeMark done;
+    size_t          added;
+    size_t          last;
+    int             err = 0;
+
+    for (size_t k = 0; !err; k++)
+    {
+        struct ring    *out = &p->decoded[k % p->decoders];
+        struct _pipeIdle idle = { 0, 0 };
+
+        while (!(batch = ringPop(out)))
+        {
+            if (atomic_load_explicit(&p->readDone, memory_order_acquire) &&
+                k >= p->produced)
+            {
+                done.packets = p->readCounters.packets;
+                done.bytes = p->readCounters.bytes;
+                done.skipped = p->readDiag.reasons[DIAG_PACKETHEAD];
+                _pipeMergeRead(p, &done);
+                return 0;
+            }
+            _pipeWait(p, &idle);
+        }
+        _pipeWake(p);
+
+        // Only what a serial run reads before a duplicate is counted
+        err = ingestApplyBatch(g, batch->records, batch->count, &added);
+        last = err ? _pipeReplay(batch, added - 1) : batch->packets - 1;
+        _pipeMergeRead(p, &batch->marks[last]);
+        statsMerge(&batch->counters);
+        diagMerge(&batch->diag);
+
+        // There are only as many batches as the free ring holds
+        ringPush(&p->free, batch);
+        _pipeWake(p);
+    }
+
+    return err;
+}
+
+// Waiting for a free batch and counting into it, returns NULL once stopped
+static struct _pipeBatch *
+_pipeTake(
+    struct _pipeline *p)
+{
+    struct _pipeBatch *batch;
+    struct _pipeIdle idle = { 0, 0 };
+
+    while (!(batch = ringPop(&p->free)))
+    {
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+        {
+            return NULL;
+        }
+        _pipeWait(p, &idle);
+    }
+
+    batch->used = 0;
+    batch->packets = 0;
+    batch->count = 0;
+    memset(&batch->counters, 0, sizeof(batch->counters));
+    memset(&batch->diag, 0, sizeof(batch->diag));
+
+    return batch;
+}
+
+// Handing batch k to its decoder, returns true if stopped first
+static bool
+_pipeSend(
+    struct _pipeline *p,
+    struct _pipeBatch *batch,
+    size_t k)
+{
+    struct _pipeIdle idle = { 0, 0 };
+
+    while (ringPush(&p->toDecode[k % p->decoders], batch))
+    {
+        if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+        {
+            return true;
+        }
+        _pipeWait(p, &idle);
+    }
+    _pipeWake(p);
+
+    return false;
+}
+
+// Copying a record into the batch, sending the batch on first if it is full.
+// Returns the batch to keep filling, NULL once stopped
+static struct _pipeBatch *
+_pipeAdd(
+    struct _pipeline *p,
+    struct _pipeBatch *batch,
+    const struct span *packet,
+    size_t *k)
+{
+    if (batch->packets == PIPERECORDS ||
+        (batch->packets && packet->length > batch->size - batch->used))
+    {
+        if (_pipeSend(p, batch, (*k)++) || !(batch = _pipeTake(p)))
+        {
+            return NULL;
+        }
+    }
+
+    // A record bigger than a batch gets one of its own, grown to fit. This
+    // is the one allocation made while the pipeline runs, and the batch
+    // keeps the bigger buffer after
+    if (packet->length > batch->size - batch->used)
+    {
+        unsigned char  *grown = realloc(batch->raw, packet->length);
+
+        if (!grown)
+        {
+            p->readErr = INGESTMEMORY;
+            return NULL;
+        }
+        batch->raw = grown;
+        batch->size = packet->length;
+    }
+
+    memcpy(batch->raw + batch->used, packet->data, packet->length);
+    batch->used += packet->length;
+    batch->lengths[batch->packets] = packet->length;
+    batch->marks[batch->packets].packets = p->readCounters.packets;
+    batch->marks[batch->packets].bytes = p->readCounters.bytes;
+    batch->marks[batch->packets].skipped = p->readDiag.reasons[DIAG_PACKETHEAD];
+    batch->packets++;
+
+    return batch;
+}
+
+// Keeping a decoded record in its batch
+static int
+_pipeRecord(
+    void *ctx,
+    struct zergRecord *rec)
+{
+    struct _pipeBatch *batch = ctx;
+
+    batch->records[batch->count++] = *rec;
+
+    return 0;
+}
+
+// Decoding a batch again into fresh counters, stopping on the duplicate left
+// records in, returns the packet it was found in
+static size_t
+_pipeReplay(
+    struct _pipeBatch *batch,
+    size_t left)
+{
+    const unsigned char *data = batch->raw;
+    size_t          i = 0;
+
+    memset(&batch->counters, 0, sizeof(batch->counters));
+    memset(&batch->diag, 0, sizeof(batch->diag));
+    statsUse(&batch->counters);
+    diagUse(&batch->diag);
+    for (; i < batch->packets; i++)
+    {
+        if (ingestPacket(data, batch->lengths[i], ingestCountdown, &left))
+        {
+            break;
+        }
+        data += batch->lengths[i];
+    }
+    diagUse(NULL);
+    statsUse(NULL);
+
+    return i < batch->packets ? i : batch->packets - 1;
+}
+
+// Adding what the reader counted up to a mark into the totals, it only ever
+// counts records read and the ones too long to keep
+static void
+_pipeMergeRead(
+    struct _pipeline *p,
+    const struct _pipeMark *mark)
+{
+    struct statsCounters read = { 0 };
+    struct diagCounters skipped = { {0} };
+
+    read.packets = mark->packets - p->merged.packets;
+    read.bytes = mark->bytes - p->merged.bytes;
+    skipped.reasons[DIAG_PACKETHEAD] = mark->skipped - p->merged.skipped;
+    statsMerge(&read);
+    diagMerge(&skipped);
+    p->merged = *mark;
+}
+
+// Waiting while another stage catches up, yielding for the first few looks
+// and then sleeping until some stage moves a batch
+static void
+_pipeWait(
+    struct _pipeline *p,
+    struct _pipeIdle *idle)
+{
+    if (idle->spins < PIPESPINS)
+    {
+        idle->spins++;
+        idle->seen = atomic_load(&p->progress);
+        sched_yield();
+        return;
+    }
+
+    // Progress since the last look means the caller should look again. A
+    // stage that moves a batch bumps progress before checking for sleepers,
+    // so either it sees this one or this one sees its progress
+    pthread_mutex_lock(&p->lock);
+    atomic_fetch_add(&p->sleepers, 1);
+    if (atomic_load(&p->progress) == idle->seen)
+    {
+        pthread_cond_wait(&p->wake, &p->lock);
+    }
+    atomic_fetch_sub(&p->sleepers, 1);
+    pthread_mutex_unlock(&p->lock);
+    idle->seen = atomic_load(&p->progress);
+}
+
+// Telling any sleeping stage that a batch moved or the pipeline stopped
+static void
+_pipeWake(
+    struct _pipeline *p)
+{
+    atomic_fetch_add(&p->progress, 1);
+    if (atomic_load(&p->sleepers))
+    {
+        pthread_mutex_lock(&p->lock);
+        pthread_cond_broadcast(&p->wake);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
@@ -0,0 +1,17 @@
+/*  zergPipeline.h  */
+
+#ifndef ZERGPIPELINE_H
+#define ZERGPIPELINE_H
+
+#include "graph.h"
+
+#define PIPEDECODERS 2
+
+// Reading, decoding and adding a pcap to the graph as three overlapping
+// stages, returns the same codes as ingestStdio
+int             pipelineIngest(
+    graph g,
+    const char *path,
+    unsigned int decoders);
+
+#endif
@@ -0,0 +1,163 @@
+/*  zergStats.c  */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <time.h>
+
+#include "zergStats.h"
+#include "zergDiag.h"
+
+#define ZERGSTATUS 1
+#define ZERGGPS 3
+
+struct zergStats zergStats;
+
+// Where this thread's counts go, NULL for the totals
+static _Thread_local struct statsCounters *_local;
+
+static const char *_phases[STATS_PHASES] = {
+    "ingest", "build", "remove", "analyze", "print"
+};
+
+// Returning the counters this thread is counting into
+static struct statsCounters *_counters(
+    void);
+
+// Returning the monotonic clock in seconds, 0 when stats are off
+double
+statsNow(
+    void)
+{
+    struct timespec ts;
+
+    if (!zergStats.enabled)
+    {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Adding the time since start to a phase
+void
+statsTime(
+    enum statsPhase phase,
+    double start)
+{
+    if (zergStats.enabled)
+    {
+        zergStats.phases[phase] += statsNow() - start;
+    }
+}
+
+// Sending this thread's counts to c, or back to the totals when c is NULL
+void
+statsUse(
+    struct statsCounters *c)
+{
+    _local = c;
+}
+
+// Adding a set of counters into the totals
+void
+statsMerge(
+    const struct statsCounters *c)
+{
+    struct statsCounters *t = &zergStats.counters;
+
+    t->packets += c->packets;
+    t->bytes += c->bytes;
+    t->gps += c->gps;
+    t->status += c->status;
+    t->duplicates += c->duplicates;
+}
+
+// Counting packets and bytes read
+void
+statsRead(
+    size_t packets,
+    size_t bytes)
+{
+    if (zergStats.enabled)
+    {
+        _counters()->packets += packets;
+        _counters()->bytes += bytes;
+    }
+}
+
+// Counting a decoded payload by its Zerg type
+void
+statsPayload(
+    unsigned int type)
+{
+    if (!zergStats.enabled)
+    {
+        return;
+    }
+
+    if (type == ZERGGPS)
+    {
+        _counters()->gps++;
+    }
+    else if (type == ZERGSTATUS)
+    {
+        _counters()->status++;
+    }
+}
+
+// Counting a duplicate Zerg id
+void
+statsDuplicate(
+    void)
+{
+    if (zergStats.enabled)
+    {
+        _counters()->duplicates++;
+    }
+}
+
+// Printing every phase time and counter
+void
+statsPrint(
+    FILE * fp)
+{
+    struct statsCounters *t = &zergStats.counters;
+
+    // Decoding is whatever part of ingest wasn't spent building the graph
+    fprintf(fp, "time %-8s %12.6f s\n", _phases[STATS_INGEST],
+            zergStats.phases[STATS_INGEST]);
+    fprintf(fp, "time %-8s %12.6f s\n", "decode",
+            zergStats.phases[STATS_INGEST] - zergStats.phases[STATS_BUILD]);
+    for (int p = STATS_BUILD; p < STATS_PHASES; p++)
+    {
+        fprintf(fp, "time %-8s %12.6f s\n", _phases[p], zergStats.phases[p]);
+    }
+
+    fprintf(fp, "packets read       %10zu\n", t->packets);
+    fprintf(fp, "bytes read         %10zu\n", t->bytes);
+    fprintf(fp, "gps payloads       %10zu\n", t->gps);
+    fprintf(fp, "status payloads    %10zu\n", t->status);
+    fprintf(fp, "duplicates         %10zu\n", t->duplicates);
+    for (int i = DIAG_NONE + 1; i < DIAG_REASONS; i++)
+    {
+        if (diagCount(i))
+        {
+            fprintf(fp, "skipped %10zu %s\n", diagCount(i), diagMsg[i]);
+        }
+    }
+    fprintf(fp, "nodes              %10zu\n", zergStats.nodes);
+    fprintf(fp, "nodes dropped      %10zu\n", zergStats.dropped);
+    fprintf(fp, "edges              %10zu\n", zergStats.edges);
+    fprintf(fp, "invalid pairs      %10zu\n", zergStats.invalid);
+    fprintf(fp, "pairs checked      %10zu\n", zergStats.pairs);
+    fprintf(fp, "pairs prefiltered  %10zu\n", zergStats.filtered);
+    fprintf(fp, "pairs exact        %10zu\n", zergStats.exact);
+}
+
+// Returning the counters this thread is counting into
+static struct statsCounters *
+_counters(
+    void)
+{
+    return _local ? _local : &zergStats.counters;
+}
@@ -0,0 +1,82 @@
+/*  zergStats.h  */
+
+#ifndef ZERGSTATS_H
+#define ZERGSTATS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// The phases main goes through, decode and build are both part of ingest
+enum statsPhase
+{
+    STATS_INGEST = 0,
+    STATS_BUILD,
+    STATS_REMOVE,
+    STATS_ANALYZE,
+    STATS_PRINT,
+    STATS_PHASES
+};
+
+// Counters kept while decoding, each decoding thread has its own set
+struct statsCounters
+{
+    size_t          packets;
+    size_t          bytes;
+    size_t          gps;
+    size_t          status;
+    size_t          duplicates;
+};
+
+// Everything reported by --stats
+struct zergStats
+{
+    bool            enabled;
+    struct statsCounters counters;
+    double          phases[STATS_PHASES];
+    size_t          nodes;
+    size_t          dropped;
+    size_t          edges;
+    size_t          invalid;
+    size_t          pairs;
+    size_t          filtered;
+    size_t          exact;
+};
+
+extern struct zergStats zergStats;
+
+// Returning the monotonic clock in seconds, 0 when stats are off
+double          statsNow(
+    void);
+
+// Adding the time since start to a phase
+void            statsTime(
+    enum statsPhase phase,
+    double start);
+
+// Sending this thread's counts to c, or back to the totals when c is NULL
+void            statsUse(
+    struct statsCounters *c);
+
+// Adding a set of counters into the totals
+void            statsMerge(
+    const struct statsCounters *c);
+
+// Counting packets and bytes read
+void            statsRead(
+    size_t packets,
+    size_t bytes);
+
+// Counting a decoded payload by its Zerg type
+void            statsPayload(
+    unsigned int type);
+
+// Counting a duplicate Zerg id
+void            statsDuplicate(
+    void);
+
+// Printing every phase time and counter
+void            statsPrint(
+    FILE * fp);
+
+#endif
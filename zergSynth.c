@@ -0,0 +1,696 @@
+/*  zergSynth.c  */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "zergHeaders.h"
+#include "netHeaders.h"
+#include "util.h"
+#include "zergSynth.h"
+
+#define ZERGSTATUS 1
+#define ZERGGPS 3
+#define ZERGVERSION 1
+#define ZERGLENGTH 12
+#define GPSLENGTH 32
+#define STATUSLENGTH 12
+#define ETHLENGTH 14
+#define VLANLENGTH 4
+#define ARPTYPE 0x0806
+#define TCP 0x06
+#define EDGEDIST 15.0
+#define METERSPERDEG 111195.0
+#define FATHOM 1.8288
+#define PI 3.1415926536
+#define CORRUPTKINDS 5
+#define SYNTHBATCH 64
+
+// A packet waiting to be written, the zerg it's from and its type
+struct _synthPacket
+{
+    unsigned int    source;
+    unsigned int    type;
+} _synthPacket;
+
+// Where a synthetic zerg is and how healthy it is
+struct _synthZerg
+{
+    double          latitude;
+    double          longitude;
+    double          altitude;
+    unsigned int    hp;
+    unsigned int    maxHp;
+} _synthZerg;
+
+// A planned swarm, the zerg and the order their packets go out in
+struct _synthPlan
+{
+    struct _synthZerg *zerg;
+    struct _synthPacket *pkts;
+    size_t          totalPkts;
+    uint64_t        state;
+} _synthPlan;
+
+// Placing every zerg and shuffling their packets, returns true if the
+// options are invalid
+static bool     _plan(
+    const struct synthOptions *opts,
+    struct _synthPlan *plan);
+
+// Freeing a planned swarm
+static void     _freePlan(
+    struct _synthPlan *plan);
+
+// Sending a batch of datagrams, returns 1 if any could not be sent
+static int      _sendBatch(
+    int sock,
+    struct mmsghdr *msgs,
+    unsigned int count);
+
+// Returning the next number from a xorshift generator
+static uint64_t _random(
+    uint64_t * state);
+
+// Returning a number from 0 up to but not including 1
+static double   _uniform(
+    uint64_t * state);
+
+// Writing big endian numbers into a buffer
+static void     _put16(
+    unsigned char *p,
+    unsigned int v);
+static void     _put24(
+    unsigned char *p,
+    unsigned int v);
+static void     _put32(
+    unsigned char *p,
+    uint32_t v);
+static void     _put64(
+    unsigned char *p,
+    uint64_t v);
+
+// Building a zerg header and payload, returns the length
+static size_t   _buildZerg(
+    unsigned char *p,
+    const struct _synthPacket *pkt,
+    const struct _synthZerg *z,
+    unsigned int sequence);
+
+// Wrapping a zerg message in the given encapsulation, returns the length
+static size_t   _buildFrame(
+    unsigned char *frame,
+    unsigned int encap,
+    const unsigned char *zerg,
+    size_t zergLength);
+
+// Building one of the kinds of packets zergmap has to skip
+static size_t   _buildCorrupt(
+    unsigned char *frame,
+    uint64_t * state,
+    unsigned int encaps);
+
+// Picking one of the enabled encapsulations
+static unsigned int _pickEncap(
+    uint64_t * state,
+    unsigned int encaps);
+
+// Writing a packet record with its header, returns true on a short write
+static bool     _writeRecord(
+    FILE * fp,
+    unsigned char *frame,
+    size_t length,
+    int swap,
+    unsigned int when);
+
+// Setting the default capture layout
+void
+synthDefaults(
+    struct synthOptions *opts)
+{
+    opts->zerg = 100;
+    opts->density = 8;
+    opts->altitude = 5;
+    opts->statusRatio = 1;
+    opts->corruptRate = 0;
+    opts->encaps = SYNTHIPV4;
+    opts->swap = 0;
+    opts->seed = 1;
+    opts->latitude = 38;
+    opts->longitude = -77;
+}
+
+// Parsing a comma separated list of encapsulations, returns true if invalid
+bool
+synthParseEncaps(
+    const char *list,
+    unsigned int *encaps)
+{
+    const char     *names[] = { "ipv4", "vlan", "qinq", "ipv6", "6in4" };
+
+    *encaps = 0;
+    while (*list)
+    {
+        size_t          length = strcspn(list, ",");
+        bool            found = false;
+
+        if (length == 3 && !strncmp(list, "all", 3))
+        {
+            *encaps |= SYNTHALL;
+            found = true;
+        }
+        for (size_t i = 0; i < sizeof(names) / sizeof(*names); i++)
+        {
+            if (length == strlen(names[i]) && !strncmp(list, names[i], length))
+            {
+                *encaps |= 1u << i;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            return true;
+        }
+
+        list += length;
+        if (*list == ',')
+        {
+            list++;
+        }
+    }
+
+    return *encaps == 0;
+}
+
+/*
+ * Zerg are spread evenly over a square sized so that each one has about
+ * density others within edge range, ignoring altitude. Every zerg sends a
+ * GPS packet and sends a status packet at statusRatio. After each packet
+ * another corrupt one follows at corruptRate, so that is the share of the
+ * capture that zergmap skips. The packets are shuffled before writing.
+ */
+
+// Writing a whole synthetic capture, returns 1 if the options are invalid
+int
+synthWrite(
+    FILE * fp,
+    const struct synthOptions *opts)
+{
+    struct _synthPlan plan;
+    struct pcapFileH fileHead;
+    unsigned char   zergMsg[ZERGLENGTH + GPSLENGTH];
+    unsigned char   frame[SYNTHFRAMEMAX];
+    size_t          length;
+    bool            err;
+
+    if (!fp || _plan(opts, &plan))
+    {
+        return 1;
+    }
+
+    setPcapHeadDefault(&fileHead, opts->swap);
+    err = safeWrite(fp, &fileHead, sizeof(fileHead), "Writing PCAP Header");
+
+    for (size_t i = 0; i < plan.totalPkts && !err; i++)
+    {
+        length = _buildZerg(zergMsg, &plan.pkts[i],
+                            &plan.zerg[plan.pkts[i].source], i);
+        length = _buildFrame(frame, _pickEncap(&plan.state, opts->encaps),
+                             zergMsg, length);
+        err = _writeRecord(fp, frame, length, opts->swap, i);
+
+        while (!err && _uniform(&plan.state) < opts->corruptRate)
+        {
+            length = _buildCorrupt(frame, &plan.state, opts->encaps);
+            err = _writeRecord(fp, frame, length, opts->swap, i);
+        }
+    }
+
+    _freePlan(&plan);
+
+    return err;
+}
+
+/*
+ * Only the Zerg header and payload go out, so the encapsulations don't
+ * apply and the only corrupt kind left is a bad version. Datagrams are
+ * sent in batches with a pause between them, UDP has no flow control and
+ * a receiver on the same host can't keep up otherwise.
+ */
+
+// Sending a synthetic swarm as Zerg datagrams on a connected socket,
+// returns 1 if the options are invalid or a send failed
+int
+synthSend(
+    int sock,
+    const struct synthOptions *opts,
+    unsigned int pause)
+{
+    struct _synthPlan plan;
+    struct mmsghdr *msgs;
+    struct iovec   *iovs;
+    unsigned char (*dgrams)[ZERGLENGTH + GPSLENGTH];
+    unsigned int    batch = 0;
+    int             err = 0;
+
+    if (_plan(opts, &plan))
+    {
+        return 1;
+    }
+
+    msgs = calloc(SYNTHBATCH, sizeof(*msgs));
+    iovs = calloc(SYNTHBATCH, sizeof(*iovs));
+    dgrams = calloc(SYNTHBATCH, sizeof(*dgrams));
+    if (!msgs || !iovs || !dgrams)
+    {
+        err = 1;
+    }
+
+    for (size_t i = 0; i < plan.totalPkts && !err; i++)
+    {
+        bool            corrupt = false;
+
+        // Each datagram can be followed by corrupt copies of itself
+        do
+        {
+            iovs[batch].iov_base = dgrams[batch];
+            iovs[batch].iov_len = _buildZerg(dgrams[batch], &plan.pkts[i],
+                                             &plan.zerg[plan.pkts[i].source],
+                                             i);
+            if (corrupt)
+            {
+                dgrams[batch][0] += 1 << 4;
+            }
+            msgs[batch].msg_hdr.msg_iov = &iovs[batch];
+            msgs[batch].msg_hdr.msg_iovlen = 1;
+
+            if (++batch == SYNTHBATCH)
+            {
+                err = _sendBatch(sock, msgs, batch);
+                batch = 0;
+                usleep(pause);
+            }
+            corrupt = _uniform(&plan.state) < opts->corruptRate;
+        } while (corrupt && !err);
+    }
+
+    if (batch && !err)
+    {
+        err = _sendBatch(sock, msgs, batch);
+    }
+
+    free(msgs);
+    free(iovs);
+    free(dgrams);
+    _freePlan(&plan);
+
+    return err;
+}
+
+// Placing every zerg and shuffling their packets, returns true if the
+// options are invalid
+static bool
+_plan(
+    const struct synthOptions *opts,
+    struct _synthPlan *plan)
+{
+    if (!opts || opts->zerg == 0 || opts->zerg > SYNTHMAXZERG ||
+        opts->density <= 0 || opts->altitude < 0 ||
+        opts->statusRatio < 0 || opts->statusRatio > 1 ||
+        opts->corruptRate < 0 || opts->corruptRate >= 1 ||
+        !(opts->encaps & SYNTHALL))
+    {
+        return true;
+    }
+
+    uint64_t        state = opts->seed * 0x9E3779B97F4A7C15ull + 1;
+    unsigned int   *ids = malloc(SYNTHMAXZERG * sizeof(*ids));
+    struct _synthZerg *zerg = calloc(SYNTHMAXZERG + 1, sizeof(*zerg));
+    struct _synthPacket *pkts = calloc(2 * opts->zerg, sizeof(*pkts));
+    size_t          totalPkts = 0;
+
+    if (!ids || !zerg || !pkts)
+    {
+        free(ids);
+        free(zerg);
+        free(pkts);
+        return true;
+    }
+
+    double          side = EDGEDIST * sqrt(PI * opts->zerg / opts->density);
+    double          lonScale = cos(opts->latitude * PI / 180);
+
+    // Drawing distinct ids and placing each zerg
+    for (unsigned int i = 0; i < SYNTHMAXZERG; i++)
+    {
+        ids[i] = i + 1;
+    }
+    for (size_t i = 0; i < opts->zerg; i++)
+    {
+        size_t          pick = i + _random(&state) % (SYNTHMAXZERG - i);
+        unsigned int    id = ids[pick];
+        struct _synthZerg *z = &zerg[id];
+
+        ids[pick] = ids[i];
+        ids[i] = id;
+
+        z->latitude = opts->latitude +
+            _uniform(&state) * side / METERSPERDEG;
+        z->longitude = opts->longitude +
+            _uniform(&state) * side / (METERSPERDEG * lonScale);
+        z->altitude = _uniform(&state) * opts->altitude;
+        z->maxHp = 100 + _random(&state) % 900;
+        z->hp = 1 + _random(&state) % z->maxHp;
+
+        pkts[totalPkts].source = id;
+        pkts[totalPkts++].type = ZERGGPS;
+        if (_uniform(&state) < opts->statusRatio)
+        {
+            pkts[totalPkts].source = id;
+            pkts[totalPkts++].type = ZERGSTATUS;
+        }
+    }
+
+    // Shuffling so GPS and status packets arrive in any order
+    for (size_t i = totalPkts; i > 1; i--)
+    {
+        size_t          j = _random(&state) % i;
+        struct _synthPacket swap = pkts[i - 1];
+
+        pkts[i - 1] = pkts[j];
+        pkts[j] = swap;
+    }
+
+    free(ids);
+    plan->zerg = zerg;
+    plan->pkts = pkts;
+    plan->totalPkts = totalPkts;
+    plan->state = state;
+
+    return false;
+}
+
+// Freeing a planned swarm
+static void
+_freePlan(
+    struct _synthPlan *plan)
+{
+    free(plan->zerg);
+    free(plan->pkts);
+}
+
+// Sending a batch of datagrams, returns 1 if any could not be sent
+static int
+_sendBatch(
+    int sock,
+    struct mmsghdr *msgs,
+    unsigned int count)
+{
+    unsigned int    sent = 0;
+
+    while (sent < count)
+    {
+        int             done = sendmmsg(sock, msgs + sent, count - sent, 0);
+
+        if (done < 0)
+        {
+            return 1;
+        }
+        sent += done;
+    }
+
+    return 0;
+}
+
+// Returning the next number from a xorshift generator
+static uint64_t
+_random(
+    uint64_t * state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+
+    return *state * 0x2545F4914F6CDD1Dull;
+}
+
+// Returning a number from 0 up to but not including 1
+static double
+_uniform(
+    uint64_t * state)
+{
+    return (_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Writing big endian numbers into a buffer
+static void
+_put16(
+    unsigned char *p,
+    unsigned int v)
+{
+    p[0] = v >> 8;
+    p[1] = v;
+}
+
+static void
+_put24(
+    unsigned char *p,
+    unsigned int v)
+{
+    p[0] = v >> 16;
+    p[1] = v >> 8;
+    p[2] = v;
+}
+
+static void
+_put32(
+    unsigned char *p,
+    uint32_t v)
+{
+    _put16(p, v >> 16);
+    _put16(p + 2, v);
+}
+
+static void
+_put64(
+    unsigned char *p,
+    uint64_t v)
+{
+    _put32(p, v >> 32);
+    _put32(p + 4, v);
+}
+
+// Building a zerg header and payload, returns the length
+static size_t
+_buildZerg(
+    unsigned char *p,
+    const struct _synthPacket *pkt,
+    const struct _synthZerg *z,
+    unsigned int sequence)
+{
+    size_t          length = ZERGLENGTH;
+    uint64_t        d;
+    uint32_t        f;
+    float           value;
+
+    if (pkt->type == ZERGGPS)
+    {
+        length += GPSLENGTH;
+        memcpy(&d, &z->longitude, sizeof(d));
+        _put64(p + ZERGLENGTH, d);
+        memcpy(&d, &z->latitude, sizeof(d));
+        _put64(p + ZERGLENGTH + 8, d);
+
+        // Altitude goes out in fathoms, zergmap converts it to meters
+        value = z->altitude / FATHOM;
+        memcpy(&f, &value, sizeof(f));
+        _put32(p + ZERGLENGTH + 16, f);
+        memset(p + ZERGLENGTH + 20, 0, 12);
+    }
+    else
+    {
+        length += STATUSLENGTH;
+        _put24(p + ZERGLENGTH, z->hp);
+        p[ZERGLENGTH + 3] = 0;
+        _put24(p + ZERGLENGTH + 4, z->maxHp);
+        p[ZERGLENGTH + 7] = 0;
+        value = 1;
+        memcpy(&f, &value, sizeof(f));
+        _put32(p + ZERGLENGTH + 8, f);
+    }
+
+    p[0] = (ZERGVERSION << 4) | pkt->type;
+    _put24(p + 1, length);
+    _put16(p + 4, pkt->source);
+    _put16(p + 6, 0);
+    _put32(p + 8, sequence);
+
+    return length;
+}
+
+// Wrapping a zerg message in the given encapsulation, returns the length
+static size_t
+_buildFrame(
+    unsigned char *frame,
+    unsigned int encap,
+    const unsigned char *zerg,
+    size_t zergLength)
+{
+    union ethernetH ethHead;
+    struct ipv4H    ipHead;
+    struct ipv6H    ip6Head;
+    struct udpH     udpHead;
+    size_t          length = ETHLENGTH;
+
+    setEthHeadDefault(&ethHead);
+    memcpy(frame, ethHead.raw, ETHLENGTH);
+
+    // Tagging the frame, QinQ being an outer tag around a 802.1Q tag
+    if (encap == SYNTHVLAN || encap == SYNTHQINQ)
+    {
+        _put16(frame + length - 2,
+               encap == SYNTHQINQ ? ETH8021Q4 : ETH8021Q);
+        if (encap == SYNTHQINQ)
+        {
+            _put16(frame + length, 1);
+            _put16(frame + length + 2, ETH8021Q);
+            length += VLANLENGTH;
+        }
+        _put16(frame + length, 2);
+        _put16(frame + length + 2, ETHIPV4);
+        length += VLANLENGTH;
+    }
+
+    // The network layers, 6in4 being IPv6 carried inside IPv4
+    if (encap == SYNTHIPV6)
+    {
+        _put16(frame + length - 2, ETHIPV6);
+    }
+    else
+    {
+        setIPHeadDefault(&ipHead, sizeof(ipHead) + sizeof(udpHead) +
+                         zergLength +
+                         (encap == SYNTH6IN4 ? sizeof(ip6Head) : 0));
+        if (encap == SYNTH6IN4)
+        {
+            ipHead.proto = IP6INIP4;
+        }
+        memcpy(frame + length, &ipHead, sizeof(ipHead));
+        length += sizeof(ipHead);
+    }
+    if (encap == SYNTHIPV6 || encap == SYNTH6IN4)
+    {
+        setIPv6HeadDefault(&ip6Head, sizeof(udpHead) + zergLength, UDP);
+        memcpy(frame + length, &ip6Head, sizeof(ip6Head));
+        length += sizeof(ip6Head);
+    }
+
+    setUDPHeadDefault(&udpHead, sizeof(udpHead) + zergLength);
+    memcpy(frame + length, &udpHead, sizeof(udpHead));
+    length += sizeof(udpHead);
+
+    memcpy(frame + length, zerg, zergLength);
+
+    return length + zergLength;
+}
+
+// Building one of the kinds of packets zergmap has to skip
+static size_t
+_buildCorrupt(
+    unsigned char *frame,
+    uint64_t * state,
+    unsigned int encaps)
+{
+    struct _synthPacket pkt = { 1, ZERGGPS };
+    struct _synthZerg z = { 0, 0, 0, 1, 1 };
+    unsigned char   zergMsg[ZERGLENGTH + GPSLENGTH];
+    size_t          length = _buildZerg(zergMsg, &pkt, &z, 0);
+    unsigned int    encap = _pickEncap(state, encaps & (SYNTHIPV4 |
+                                                        SYNTHVLAN));
+    size_t          ipAt = ETHLENGTH + (encap == SYNTHVLAN ? VLANLENGTH : 0);
+    size_t          udpAt = ipAt + sizeof(struct ipv4H);
+
+    length = _buildFrame(frame, encap, zergMsg, length);
+
+    switch (_random(state) % CORRUPTKINDS)
+    {
+    case 0:
+        // Not an IP packet at all
+        _put16(frame + ipAt - 2, ARPTYPE);
+        break;
+    case 1:
+        // Not UDP
+        frame[ipAt + 9] = TCP;
+        break;
+    case 2:
+        // UDP, but not to the zerg port
+        _put16(frame + udpAt + 2, 53);
+        break;
+    case 3:
+        // An unknown zerg version
+        frame[udpAt + 8] = (2 << 4) | ZERGGPS;
+        break;
+    default:
+        // A runt frame
+        length = ETHLENGTH + 10;
+        break;
+    }
+
+    return length;
+}
+
+// Picking one of the enabled encapsulations
+static unsigned int
+_pickEncap(
+    uint64_t * state,
+    unsigned int encaps)
+{
+    unsigned int    choices[5];
+    unsigned int    count = 0;
+
+    for (unsigned int bit = SYNTHIPV4; bit <= SYNTH6IN4; bit <<= 1)
+    {
+        if (encaps & bit)
+        {
+            choices[count++] = bit;
+        }
+    }
+    if (!count)
+    {
+        return SYNTHIPV4;
+    }
+
+    return choices[_random(state) % count];
+}
+
+// Writing a packet record with its header, returns true on a short write
+static bool
+_writeRecord(
+    FILE * fp,
+    unsigned char *frame,
+    size_t length,
+    int swap,
+    unsigned int when)
+{
+    struct pcapPacketH packetHead;
+
+    setPacketHeadDefault(&packetHead, length);
+    packetHead.unixEpoch = when / 1000;
+    packetHead.microEpoch = when % 1000 * 1000;
+    if (swap)
+    {
+        packetHead.unixEpoch = u32BitSwap(packetHead.unixEpoch);
+        packetHead.microEpoch = u32BitSwap(packetHead.microEpoch);
+        packetHead.length = u32BitSwap(packetHead.length);
+        packetHead.untrunLength = u32BitSwap(packetHead.untrunLength);
+    }
+
+    return safeWrite(fp, &packetHead, sizeof(packetHead),
+                     "Writing Packet Header") ||
+        safeWrite(fp, frame, length, "Writing Packet");
+}
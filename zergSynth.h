@@ -0,0 +1,57 @@
+/*  zergSynth.h  */
+
+#ifndef ZERGSYNTH_H
+#define ZERGSYNTH_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define SYNTHIPV4 0x01
+#define SYNTHVLAN 0x02
+#define SYNTHQINQ 0x04
+#define SYNTHIPV6 0x08
+#define SYNTH6IN4 0x10
+#define SYNTHALL 0x1f
+
+#define SYNTHMAXZERG 65535
+#define SYNTHFRAMEMAX 256
+
+// How a synthetic capture is laid out
+struct synthOptions
+{
+    size_t          zerg;
+    double          density;
+    double          altitude;
+    double          statusRatio;
+    double          corruptRate;
+    unsigned int    encaps;
+    int             swap;
+    unsigned long   seed;
+    double          latitude;
+    double          longitude;
+};
+
+// Setting the default capture layout
+void            synthDefaults(
+    struct synthOptions *opts);
+
+// Parsing a comma separated list of encapsulations, returns true if invalid
+bool            synthParseEncaps(
+    const char *list,
+    unsigned int *encaps);
+
+// Writing a whole synthetic capture, returns 1 if the options are invalid
+int             synthWrite(
+    FILE * fp,
+    const struct synthOptions *opts);
+
+// Sending a synthetic swarm as Zerg datagrams on a connected socket, pausing
+// for pause microseconds between batches, returns 1 if the options are
+// invalid or a send failed
+int             synthSend(
+    int sock,
+    const struct synthOptions *opts,
+    unsigned int pause);
+
+#endif
@@ -3,12 +3,32 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <getopt.h>
 
 #include "zergHeaders.h"
 #include "netHeaders.h"
 #include "zergDecode.h"
 #include "util.h"
 #include "graph.h"
+#include "zergIngest.h"
+#include "zergStats.h"
+#include "zergDiag.h"
+#include "zergDaemon.h"
+#include "zergPipeline.h"
+
+#define STATSOPT 256
+#define SAMPLEOPT 257
+#define LISTENOPT 258
+#define BINDOPT 259
+#define INTERVALOPT 260
+#define CHANGESOPT 261
+#define FOLLOWOPT 262
+#define PIPELINEOPT 263
+
+// Printing the stats to stderr, or to path if one was given
+static void     _printStats(
+    graph g,
+    const char *path);
 
 // Main Function for the program
 int
@@ -17,33 +37,134 @@ main(
     char *argv[])
 {
     // Initializing Variables
-    FILE           *fp;
-    struct pcapPacketH ppHeader;
-    union zergH     zHeader;
-    struct gpsH     zGPS;
-    struct statusH  zStatus;
     int             err = 0;
-    int             swap = 0;
-    long int        dataLength = 0;
-    unsigned int    skipBytes = 0;
+    bool            useMap = false;
+    unsigned int    threads = 0;
+    unsigned int    decoders = 0;
+    enum diagLevel  level = DIAG_SUMMARY;
+    unsigned int    sample = DIAGSAMPLE;
+    bool            follow = false;
+    struct daemonOptions daemon;
 
     // Setting getopt to not display errors
     opterr = 0;
     int             optCode;
     int             minHp = 10;
+    const char     *statsPath = NULL;
+    double          start;
+    double          built;
+    size_t          before = 0;
+    size_t          unused = 0;
+    static const struct option longOpts[] = {
+        {"stats", optional_argument, NULL, STATSOPT},
+        {"sample", required_argument, NULL, SAMPLEOPT},
+        {"listen", optional_argument, NULL, LISTENOPT},
+        {"bind", required_argument, NULL, BINDOPT},
+        {"interval", required_argument, NULL, INTERVALOPT},
+        {"changes", required_argument, NULL, CHANGESOPT},
+        {"follow", no_argument, NULL, FOLLOWOPT},
+        {"pipeline", optional_argument, NULL, PIPELINEOPT},
+        {NULL, 0, NULL, 0}
+    };
+
+    daemonDefaults(&daemon);
 
     // Looping through each flag
-    while ((optCode = getopt(argc, argv, "h:")) != -1)
+    while ((optCode = getopt_long(argc, argv, "h:j:mqv", longOpts, NULL)) != -1)
     {
         switch (optCode)
         {
         case 'h':
             minHp = strtol(optarg, NULL, 10);
             break;
+        case 'j':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 'm':
+            useMap = true;
+            break;
+        case 'q':
+            level = DIAG_QUIET;
+            break;
+        case 'v':
+            level = DIAG_VERBOSE;
+            break;
+        case SAMPLEOPT:
+            sample = strtoul(optarg, NULL, 10);
+            break;
+        case LISTENOPT:
+            daemon.listen = true;
+            if (optarg)
+            {
+                daemon.port = strtoul(optarg, NULL, 10);
+            }
+            break;
+        case BINDOPT:
+            daemon.address = optarg;
+            break;
+        case INTERVALOPT:
+            daemon.interval = strtod(optarg, NULL);
+            if (!(daemon.interval > 0))
+            {
+                fprintf(stderr, "Invalid interval: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case CHANGESOPT:
+            daemon.changes = strtoul(optarg, NULL, 10);
+            break;
+        case FOLLOWOPT:
+            follow = true;
+            break;
+        case PIPELINEOPT:
+            decoders = optarg ? strtoul(optarg, NULL, 10) : PIPEDECODERS;
+            if (decoders == 0)
+            {
+                fprintf(stderr, "Invalid amount of decoders: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case STATSOPT:
+            zergStats.enabled = true;
+            statsPath = optarg;
+            break;
         default:
-            fprintf(stderr, "Unknown flag -%c\n", optopt);
+            if (optopt)
+            {
+                fprintf(stderr, "Unknown flag -%c\n", optopt);
+            }
+            else
+            {
+                fprintf(stderr, "Unknown flag %s\n", argv[optind - 1]);
+            }
+            return 1;
+        }
+    }
+
+    diagSetLevel(level, sample);
+
+    if (threads > 0 && decoders > 0)
+    {
+        fprintf(stderr, "Can't use -j with --pipeline\n");
+        return 1;
+    }
+
+    // Listening for live datagrams or following growing captures instead
+    // of reading them once
+    if (daemon.listen || follow)
+    {
+        if ((argc - optind != 0) != follow)
+        {
+            fprintf(stderr, "Invalid amount of args\n");
             return 1;
         }
+        daemon.follow = &argv[optind];
+        daemon.follows = follow ? argc - optind : 0;
+        daemon.minHp = minHp;
+        err = daemonRun(&daemon);
+        diagSummary(stderr);
+        _printStats(NULL, statsPath);
+        return err;
     }
 
     // Checking for valid amount for args
@@ -58,104 +179,142 @@ main(
 
     if (!zergGraph)
     {
+        fprintf(stderr, "Out of memory\n");
         return 1;
     }
+    graphDeferEdges(zergGraph, true);
 
-    // Looping through all the files
-    for (int i = optind; i < argc; i++)
+    // Standard input can't be mapped and split, so it is read serially
+    for (int i = optind; i < argc && threads > 0; i++)
     {
-        // Attempting to open the file given
-        fp = fopen(argv[i], "r");
-        if (fp == NULL)
+        if (!strcmp(argv[i], INGESTSTDIN))
         {
-            fprintf(stderr, "Unable to open the file: %s\n", argv[1]);
-            graphDestroy(zergGraph);
-            return 1;
+            threads = 0;
         }
+    }
+
+    // Decoding the files on worker threads
+    start = statsNow();
+    if (threads > 0)
+    {
+        err = ingestFiles(zergGraph, &argv[optind], argc - optind, threads);
+    }
 
-        // Reading the first header of the file
-        if (invalidPCAPHeader(fp, &swap))
+    // Looping through all the files
+    for (int i = optind; i < argc && threads == 0; i++)
+    {
+        if (decoders > 0)
         {
-            graphDestroy(zergGraph);
-            return 1;
+            err = pipelineIngest(zergGraph, argv[i], decoders);
         }
-
-        // Main reading loop
-        while (setPacketHead(fp, &ppHeader, swap))
+        else if (useMap)
         {
-            skipBytes = ppHeader.length;
-            dataLength = ftell(fp);
-
-            // Validating the Ethernet and IP headers
-            if (invalidEthOrIp(fp, ppHeader.length, &skipBytes))
-            {
-                continue;
-            }
-
-            // Validating the UDP and Zerg Header
-            if (invalidZergHeader(fp, &zHeader, &skipBytes))
-            {
-                continue;
-            }
-
-            // Printing the correct payload
-            switch (getZType(&zHeader))
-            {
-            case 1:
-                // Adding a status to the graph
-                setZStatus(fp, &zStatus, sizeof(zStatus));
-                err = graphAddStatus(zergGraph, zHeader, zStatus);
-                break;
-            case 3:
-                // Adding a Zerg to the graph
-                setZGPS(fp, &zGPS, sizeof(zGPS));
-                err = graphAddNode(zergGraph, zHeader, &zGPS);
-                break;
-
-            default:
-                fprintf(stderr, "Invalid Zerg payload, Skipping packet\n");
-            }
+            err = ingestFile(argv[i], ingestApply, zergGraph);
+        }
+        else
+        {
+            err = ingestStdio(argv[i], ingestApply, zergGraph);
+        }
 
-            // Checking if there were any errors in printing
-            if (err == 2)
-            {
-                fprintf(stderr, "Duplicate Zerg Ids! Exiting...\n");
-                break;
-            }
-            else if (err > 0)
-            {
-                fprintf(stderr, "A payload error occurred, Skipping packet\n");
-            }
+        if (err)
+        {
+            break;
+        }
+    }
 
-            // Reading any extra data 
-            dataLength = (ftell(fp) - dataLength);
-            if (dataLength != ppHeader.length)
-            {
-                skipAhead(fp, 0, "", (ppHeader.length - dataLength));
-            }
+    // Adding the edges for everything that was read in one pass
+    built = statsNow();
+    graphBuildEdges(zergGraph);
+    statsTime(STATS_BUILD, built);
+    statsTime(STATS_INGEST, start);
 
-        }
+    // A graph missing records would print the wrong removals
+    if (err == INGESTMEMORY || (!err && graphOutOfMemory(zergGraph)))
+    {
+        fprintf(stderr, "Out of memory\n");
+        err = 1;
+    }
 
-        fclose(fp);
+    if (err)
+    {
         if (err == 2)
         {
-            graphDestroy(zergGraph);
-            return 2;
+            fprintf(stderr, "Duplicate Zerg Ids! Exiting...\n");
         }
+        diagSummary(stderr);
+        _printStats(zergGraph, statsPath);
+        graphDestroy(zergGraph);
+        return err;
     }
 
     // Removing incomplete zerg items
+    start = statsNow();
+    graphCounts(zergGraph, &before, &unused, &unused);
     graphRemoveBadNodes(zergGraph);
+    statsTime(STATS_REMOVE, start);
+    graphCounts(zergGraph, &zergStats.nodes, &unused, &unused);
+    zergStats.dropped = before - zergStats.nodes;
 
     // Analyzing the graph
+    start = statsNow();
     graphAnalyzeGraph(zergGraph);
+    statsTime(STATS_ANALYZE, start);
+
+    if (graphOutOfMemory(zergGraph))
+    {
+        fprintf(stderr, "Out of memory\n");
+        diagSummary(stderr);
+        _printStats(zergGraph, statsPath);
+        graphDestroy(zergGraph);
+        return 1;
+    }
 
     // Printing Graph information
+    start = statsNow();
     graphPrint(zergGraph);
     graphPrintLowHP(zergGraph, minHp);
+    statsTime(STATS_PRINT, start);
+
+    diagSummary(stderr);
+    _printStats(zergGraph, statsPath);
 
     // Disassembling the graph
     graphDestroy(zergGraph);
 
     return 0;
 }
+
+// Printing the stats to stderr, or to path if one was given
+static void
+_printStats(
+    graph g,
+    const char *path)
+{
+    FILE           *fp = stderr;
+
+    if (!zergStats.enabled)
+    {
+        return;
+    }
+
+    if (g)
+    {
+        graphCounts(g, &zergStats.nodes, &zergStats.edges, &zergStats.invalid);
+        graphPairCounts(g, &zergStats.pairs, &zergStats.filtered,
+                        &zergStats.exact);
+    }
+
+    if (path && !(fp = fopen(path, "w")))
+    {
+        fprintf(stderr, "Unable to open the file: %s\n", path);
+        return;
+    }
+
+    statsPrint(fp);
+    graphPrintAllocs(g, fp);
+
+    if (fp != stderr)
+    {
+        fclose(fp);
+    }
+}